@@ -0,0 +1,348 @@
+// Benchmarks of the computationally expensive parts of genetIC, at a range of grid sizes and thread counts.
+//
+// Results are written to stdout as CSV, one row per (benchmark, grid size, thread count), so that runs of
+// different versions can be compared directly. Log output from the code being benchmarked goes to stderr as usual.
+//
+// usage: genetIC_benchmark [-n 32,64,128] [-t 1,2,4] [-r repeats] [-o output_directory]
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tools/parser.hpp"
+#include "tools/logging.hpp"
+#include "tools/filesystem.h"
+#include "ic.hpp"
+
+#ifdef DOUBLEPRECISION
+typedef double FloatType;
+#else
+typedef float FloatType;
+#endif
+
+using T = FloatType;
+using ICf = ICGenerator<T>;
+
+/*! \class BenchmarkICGenerator
+    \brief ICGenerator that exposes the particle mapper, so that iterating over it can be timed in isolation.
+*/
+class BenchmarkICGenerator : public ICf {
+public:
+  BenchmarkICGenerator(tools::ClassDispatch<ICf, void> &interpreter) : ICf(interpreter) {}
+
+  //! Set up a base grid with a zoom region, using a power-law spectrum so no transfer function file is needed
+  void setUpZoomedBox(size_t n) {
+    setPowerLawAmplitude(1.0);
+    setZ0(99);
+    setSeed(8896131);
+    initBaseGrid(50.0, n);
+    setCentre(25.0, 25.0, 25.0);
+    selectSphere(5.0);
+    initZoomGrid(2, n);
+  }
+
+  //! As the base class, but skipped if already applied, so that write() only times the output itself
+  void applyPowerSpec() override {
+    if (outputFields[0]->getTransferType() == particle::species::whitenoise)
+      ICf::applyPowerSpec();
+  }
+
+  //! Draw the random field, apply the power spectrum and construct the particle generators
+  void prepareParticles() {
+    initialiseRandomComponentIfUninitialised();
+    applyPowerSpec();
+    ensureParticleGeneratorInitialised();
+  }
+
+  //! Evaluate every dark matter particle once through the mapper, returning the number visited
+  size_t iterateMapper() {
+    const auto &generator = *pParticleGenerator[particle::species::dm];
+    auto begin = pMapper->beginDm(generator);
+    size_t nParticles = pMapper->endDm(generator).getIndex() - begin.getIndex();
+    std::vector<T> x(nParticles);
+    begin.parallelIterate([&x](size_t i, const particle::mapper::MapperIterator<T> &localIterator) {
+      x[i] = localIterator.getParticle().pos.x;
+    }, nParticles);
+    return nParticles;
+  }
+
+  size_t getNumParticles() const {
+    return pMapper->size();
+  }
+};
+
+//! Command-line settings for the benchmark run
+struct BenchmarkSettings {
+  std::vector<size_t> gridSizes = {32, 64};
+  std::vector<int> threadCounts = {1};
+  size_t repeats = 3;
+  std::string outputDirectory;
+};
+
+std::vector<size_t> parseList(const std::string &commaSeparated) {
+  std::vector<size_t> values;
+  std::istringstream ss(commaSeparated);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    values.push_back(std::stoul(item));
+  return values;
+}
+
+BenchmarkSettings parseArguments(int argc, char *argv[]) {
+  BenchmarkSettings settings;
+  settings.outputDirectory = access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+
+  for (int i = 1; i < argc; ++i) {
+    std::string flag(argv[i]);
+    if (i + 1 >= argc)
+      throw std::runtime_error("Missing value for argument " + flag);
+    std::string value(argv[++i]);
+    if (flag == "-n") {
+      settings.gridSizes = parseList(value);
+    } else if (flag == "-t") {
+      settings.threadCounts.clear();
+      for (auto t : parseList(value))
+        settings.threadCounts.push_back(static_cast<int>(t));
+    } else if (flag == "-r") {
+      settings.repeats = std::stoul(value);
+    } else if (flag == "-o") {
+      settings.outputDirectory = value;
+    } else {
+      throw std::runtime_error("Unknown argument " + flag);
+    }
+  }
+  return settings;
+}
+
+void setNumThreads(int nThreads) {
+#ifdef _OPENMP
+  omp_set_num_threads(nThreads);
+#endif
+  tools::numerics::fourier::initialise();
+#ifdef FFTW_THREADS
+  fftw_plan_with_nthreads(nThreads);
+#endif
+  // plans made earlier use the previous number of threads
+  tools::numerics::fourier::clearPlanCache();
+}
+
+/*! \brief Time a benchmark and write its results as one CSV row.
+ *
+ * \param name - name of the benchmark, as reported in the output
+ * \param setup - called before each repeat, outside the timed region
+ * \param run - the operation to be timed; returns the number of items (cells or particles) it processed
+ */
+void timeBenchmark(const std::string &name, size_t gridSize, int nThreads, size_t repeats,
+                   std::function<void()> setup, std::function<size_t()> run) {
+  double minSeconds = std::numeric_limits<double>::max();
+  double totalSeconds = 0;
+  size_t items = 0;
+
+  for (size_t i = 0; i < repeats; ++i) {
+    setup();
+    auto start = std::chrono::steady_clock::now();
+    items = run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    minSeconds = std::min(minSeconds, seconds);
+    totalSeconds += seconds;
+  }
+
+  std::cout << name << "," << gridSize << "," << nThreads << "," << repeats << "," << items << ","
+            << minSeconds << "," << totalSeconds / repeats << "," << double(items) / minSeconds << std::endl;
+}
+
+//! Benchmarks of individual field operations on a single grid of side n
+void runFieldBenchmarks(size_t n, int nThreads, size_t repeats) {
+  const T boxSize = 50.0;
+  const size_t nCells = n * n * n;
+  auto pGrid = std::make_shared<grids::Grid<T>>(boxSize, n, boxSize / n);
+
+  // A smooth covariance, like those generated from a power spectrum
+  fields::Field<T> covariance(*pGrid, true);
+  covariance.forEachFourierCell([](std::complex<T>, T kx, T ky, T kz) {
+    T k2 = kx * kx + ky * ky + kz * kz;
+    return std::complex<T>(k2 == 0 ? 0 : 1.0 / (1.0 + k2), 0);
+  });
+
+  fields::Field<T> field(*pGrid, false);
+  auto fillField = [&field, nCells]() {
+    field.setFourier(false);
+    auto &data = field.getDataVector();
+    for (size_t i = 0; i < nCells; ++i)
+      data[i] = T(i % 17) - 8;
+  };
+
+  timeBenchmark("fft", n, nThreads, repeats, fillField, [&]() {
+    field.toFourier();
+    field.toReal();
+    return 2 * nCells;
+  });
+
+  timeBenchmark("apply_transfer", n, nThreads, repeats, [&]() {
+    fillField();
+    field.toFourier();
+  }, [&]() {
+    field.applyTransferFunction(covariance, 0.5);
+    return nCells;
+  });
+
+  // A composite of the kind applied between levels when converting to a covector
+  filters::LowPassFermiFilter<T> lowPass(pGrid->getFourierKmax() / 8);
+  filters::ComplementaryCovarianceFilterAdaptor<filters::LowPassFermiFilter<T>> highPass(pGrid->getFourierKmax() / 8);
+  timeBenchmark("apply_filter", n, nThreads, repeats, [&]() {
+    fillField();
+    field.toFourier();
+  }, [&]() {
+    field.applyFilter(lowPass * highPass * T(0.5));
+    return nCells;
+  });
+
+  timeBenchmark("draw", n, nThreads, repeats, []() {}, [&]() {
+    multilevelgrid::MultiLevelGrid<T> context;
+    context.addLevel(boxSize, n);
+    fields::OutputField<T> whiteNoise(context, particle::species::whitenoise);
+    fields::RandomFieldGenerator<T> generator(whiteNoise);
+    generator.seed(8896131);
+    generator.draw();
+    return nCells;
+  });
+
+  // All three components of the real-space gradient, as used for the Zeldovich offsets without
+  // ZELDOVICH_GRADIENT_FOURIER_SPACE; compare with three inverse transforms in the fft benchmark
+  fields::Field<T> gradientX(*pGrid, false), gradientY(*pGrid, false), gradientZ(*pGrid, false);
+  timeBenchmark("fd_gradient", n, nThreads, repeats, fillField, [&]() {
+    T *outputs[3] = {gradientX.getDataVector().data(), gradientY.getDataVector().data(),
+                     gradientZ.getDataVector().data()};
+    tools::numerics::fourthOrderGradient(field.getDataVector().data(), n, pGrid->cellSize, outputs);
+    return nCells;
+  });
+
+  // Visit every cell in the spatially clustered order used when evaluating fields for particles
+  std::vector<T> visited(nCells);
+  timeBenchmark("iterate_clustered", n, nThreads, repeats, []() {}, [&]() {
+    pGrid->parallelIterateOverCellsSpatiallyClustered([&visited](size_t i) { visited[i] = T(i); });
+    return nCells;
+  });
+
+  // Interpolate onto a grid of the same size covering the central eighth of the volume at twice the resolution
+  auto pFineGrid = std::make_shared<grids::Grid<T>>(boxSize, n, boxSize / n / 2, boxSize / 4, boxSize / 4,
+                                                    boxSize / 4);
+  fields::Field<T> fineField(*pFineGrid, false);
+  timeBenchmark("interpolate", n, nThreads, repeats, [&]() {
+    fillField();
+    tools::storage::fillInParallel(fineField.getDataVector(), T(0));
+  }, [&]() {
+    fineField.addFieldFromDifferentGrid(const_cast<const fields::Field<T> &>(field));
+    return nCells;
+  });
+
+  // Evaluate on a grid subsampled by a factor of four, as for particles in a subsampled base grid; the rate is
+  // given per stored cell averaged
+  auto pSubsampledGrid = pGrid->makeSubsampled(4);
+  fillField();
+  auto pStoredField = std::make_shared<fields::Field<T>>(field);
+  auto subsampledEvaluator = fields::makeEvaluator(*pStoredField, *pSubsampledGrid);
+  std::vector<T> subsampledValues(pSubsampledGrid->size3);
+  timeBenchmark("subsample", n, nThreads, repeats, []() {}, [&]() {
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < subsampledValues.size(); ++i)
+      subsampledValues[i] = (*subsampledEvaluator)[i];
+    return nCells;
+  });
+
+  // Splice a new field into a central sphere of radius a quarter of the box
+  std::vector<size_t> flags;
+  pGrid->appendIdsInRegion(Coordinate<T>(boxSize / 2), Coordinate<T>(boxSize / 4),
+                           [boxSize](T dx, T dy, T dz) {
+                             return dx * dx + dy * dy + dz * dz < boxSize * boxSize / 16;
+                           }, flags);
+  pGrid->flagCells(flags);
+  fields::Field<T> other(*pGrid, false);
+  timeBenchmark("splice", n, nThreads, repeats, [&]() {
+    fillField();
+    other.setFourier(false);
+    auto &data = other.getDataVector();
+    for (size_t i = 0; i < nCells; ++i)
+      data[i] = T(i % 13) - 6;
+  }, [&]() {
+    modifications::spliceOneLevel(field, other, covariance);
+    return nCells;
+  });
+  pGrid->unflagAllCells();
+}
+
+//! Benchmarks of particle generation and output, for a base grid of side n with a zoom region
+void runParticleBenchmarks(size_t n, int nThreads, size_t repeats) {
+  tools::ClassDispatch<ICf, void> interpreter;
+  std::unique_ptr<BenchmarkICGenerator> pGenerator;
+
+  auto makeGenerator = [&](io::OutputFormat format, int supersample = 1) {
+    pGenerator = std::make_unique<BenchmarkICGenerator>(interpreter);
+    pGenerator->setOutName("benchmark");
+    pGenerator->setOutputFormat(format);
+    pGenerator->setUpZoomedBox(n);
+    if (supersample > 1)
+      pGenerator->setSupersample(supersample);
+    pGenerator->prepareParticles();
+  };
+
+  timeBenchmark("mapper_iteration", n, nThreads, repeats, [&]() {
+    makeGenerator(io::OutputFormat::tipsy);
+  }, [&]() {
+    return pGenerator->iterateMapper();
+  });
+
+  // The zoom particles are interpolated onto a grid twice as fine in each direction
+  timeBenchmark("mapper_iteration_supersampled", n, nThreads, repeats, [&]() {
+    makeGenerator(io::OutputFormat::tipsy, 2);
+  }, [&]() {
+    return pGenerator->iterateMapper();
+  });
+
+  std::vector<std::pair<std::string, io::OutputFormat>> formats = {{"write_gadget3", io::OutputFormat::gadget3},
+                                                                    {"write_tipsy",   io::OutputFormat::tipsy},
+                                                                    {"write_grafic",  io::OutputFormat::grafic}};
+  for (auto &format : formats) {
+    timeBenchmark(format.first, n, nThreads, repeats, [&]() {
+      makeGenerator(format.second);
+    }, [&]() {
+      pGenerator->write();
+      return pGenerator->getNumParticles();
+    });
+  }
+}
+
+int main(int argc, char *argv[]) {
+  BenchmarkSettings settings;
+  try {
+    settings = parseArguments(argc, argv);
+  } catch (std::exception &e) {
+    logging::entry() << "Error: " << e.what() << std::endl;
+    logging::entry() << "usage: genetIC_benchmark [-n 32,64,128] [-t 1,2,4] [-r repeats] [-o output_directory]"
+                     << std::endl;
+    return -1;
+  }
+
+  // Particle outputs are written into the output directory, which should ideally be on tmpfs so that the
+  // benchmark measures the writers rather than the disk
+  tools::ChangeCwdWhileInScope temporary(settings.outputDirectory);
+
+  std::cout << "benchmark,grid_size,threads,repeats,items,min_seconds,mean_seconds,items_per_second" << std::endl;
+
+  for (int nThreads : settings.threadCounts) {
+    setNumThreads(nThreads);
+    for (size_t n : settings.gridSizes) {
+      runFieldBenchmarks(n, nThreads, settings.repeats);
+      runParticleBenchmarks(n, nThreads, settings.repeats);
+    }
+  }
+
+  return 0;
+}
@@ -11,6 +11,8 @@
 #include "src/io/input.hpp"
 #include "src/simulation/particles/particle.hpp"
 #include "src/tools/logging.hpp"
+#include "src/tools/fieldstorage.hpp"
+#include "src/io/cache.hpp"
 
 /*!
     \namespace cosmology
@@ -74,15 +76,50 @@ namespace cosmology {
       auto result = this->calculatedCovariancesCache[cacheKey];
 
       if (result == nullptr) {
-        result = getPowerSpectrumForGridUncached(grid, transferType);
+        // Covariances are large and, once calculated, only read occasionally
+        tools::storage::UseBackingStore useBackingStore;
+        result = getPowerSpectrumForGridFromDiskCache(grid, transferType);
         this->calculatedCovariancesCache[cacheKey] = result;
       }
 
       return result;
     }
 
+    //! Returns a hash of everything that determines the power spectrum on the given grid, for use with io::cache
+    io::cache::Hasher getHashForGrid(const grids::Grid<CoordinateType> &grid,
+                                     particle::species transferType = particle::species::dm) const {
+      io::cache::Hasher hash("covariance");
+      addParametersToHash(hash);
+      hash.add(grid.thisGridSize).add(grid.size).add(transferType);
+      return hash;
+    }
+
 
   protected:
+    //! Add the parameters that define this power spectrum to a hash
+    virtual void addParametersToHash(io::cache::Hasher &hash) const = 0;
+
+    //! Load the power spectrum for a given grid from the on-disk cache if possible; otherwise calculate and store it
+    std::shared_ptr<fields::Field<DataType, CoordinateType>>
+    getPowerSpectrumForGridFromDiskCache(const std::shared_ptr<const grids::Grid<CoordinateType>> &grid,
+                                         particle::species transferType) const {
+      if (!io::cache::isEnabled())
+        return getPowerSpectrumForGridUncached(grid, transferType);
+
+      auto key = getHashForGrid(*grid, transferType);
+      auto P = std::make_shared<fields::Field<DataType, CoordinateType>>(*grid, true);
+      bool fourier;
+      if (io::cache::load<DataType>(key, P->getDataVector(), fourier)) {
+        logging::entry() << "Loaded power spectrum for grid of side " << grid->size << " from cache" << std::endl;
+        P->setFourier(fourier);
+        return P;
+      }
+
+      P = getPowerSpectrumForGridUncached(grid, transferType);
+      io::cache::save<DataType>(key, P->getDataVector(), P->isFourier());
+      return P;
+    }
+
     //! Calculate the theoretical power spectrum for a given grid
     virtual std::shared_ptr<fields::Field<DataType, CoordinateType>>
     getPowerSpectrumForGridUncached(std::shared_ptr<const grids::Grid<CoordinateType>> grid,
@@ -151,6 +188,11 @@ namespace cosmology {
         return amplitude * pow(k, ns);
     }
 
+  protected:
+    void addParametersToHash(io::cache::Hasher &hash) const override {
+      hash.add(std::string("power_law")).add(ns).add(amplitude);
+    }
+
   };
 
   /*! \class CAMB
@@ -205,6 +247,12 @@ namespace cosmology {
 
   protected:
 
+    void addParametersToHash(io::cache::Hasher &hash) const override {
+      hash.add(std::string("camb")).add(amplitude).add(ns).add(kInterpolationPoints);
+      for (const auto &speciesAndPoints : speciesToInterpolationPoints)
+        hash.add(speciesAndPoints.first).add(speciesAndPoints.second);
+    }
+
       //! \brief This function imports data from a CAMB file, supplied as a file-name string argument (filename).
       //! Both pre-2015 and post-2015 formats can be used, and the function will detect which.
       void readLinesFromCambOutput(std::string filename) {
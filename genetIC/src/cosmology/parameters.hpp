@@ -7,9 +7,6 @@
 
 namespace cosmology {
 
-  template<typename DataType>
-  class CAMB;
-
   /*! \struct CosmologicalParameters
       \brief Stores data about the cosmological model being assumed.
 
@@ -85,104 +82,6 @@ namespace cosmology {
   }
 
 
-  //! \brief Dump an estimated power spectrum for the field, alongside the specified theory power spectrum, to disk
-  // TODO Refactor this to use grid methods and normalisations method. It could be compacted in a few lines method
-  // and avoid repeating assumptions from elsewhere in the code.
-  template<typename DataType, typename FloatType=tools::datatypes::strip_complex<DataType>>
-  void dumpPowerSpectrum(const fields::Field<DataType> &field,
-                         const fields::Field<DataType> &P0, const std::string &filename) {
-
-    // Strategy here is to estimate the power spectrum by summing over all points in the
-    // generated field in Fourier space, and assigning them to fixed-width k bins according
-    // to k = \sqrt{kx^2 + ky^2 + kz^2}. Take the average of |\delta_k|^2 in each bin to get
-    // the power spectrum at the average value of k in that bin. More accurate for high k-modes, since
-    // there are more of them able to fit in the simulation box.
-
-    field.ensureFourierModesAreMirrored();
-    P0.ensureFourierModesAreMirrored();
-
-    int res = field.getGrid().size; // Over-density field
-    int nBins = 100; // Bins used to estimate the power spectrum
-    std::vector<FloatType> inBin(nBins); // Wavenumbers contributing to a given k bin.
-    std::vector<FloatType> kbin(nBins); // Sum of k = \sqrt{kx^2 + ky^2 + kz^2} value contributing to this bin.
-    std::vector<FloatType> Gx(nBins); // Sum of |\delta_k|^2 contributing to this bin.
-    std::vector<FloatType> Px(nBins); // Sum of 'exact' values of power spectrum for k contributing to this bin.
-
-
-    // Get the range of k-modes to compute the power spectrum for, based on the size of the simulation box
-    // and grid-scale:
-    const FloatType boxLength = field.getGrid().thisGridSize;
-    FloatType kmax = M_PI / boxLength * (FloatType) res, kmin = 2.0f * M_PI / boxLength, dklog =
-      log10(kmax / kmin) / nBins, kw = 2.0f * M_PI / boxLength;
-
-    // Initialise storage for bins:
-    int ix, iy, iz, idx;
-    FloatType kfft;
-
-    for (ix = 0; ix < nBins; ix++) {
-      inBin[ix] = 0;
-      Gx[ix] = 0.0f;
-      kbin[ix] = 0.0f;
-    }
-
-
-    // Iterate over all Fourier modes of the field:
-    for (ix = -res / 2; ix < res / 2 + 1; ix++)
-      for (iy = -res / 2; iy < res / 2 + 1; iy++)
-        for (iz = -res / 2; iz < res / 2 + 1; iz++) {
-          // Compute square of the Fourier mode:
-          auto fieldValue = field.getFourierCoefficient(ix, iy, iz);
-          FloatType vabs = std::abs(fieldValue);
-          vabs *= vabs;
-
-          // Compute k for this Fourier mode:
-          kfft = sqrt(ix * ix + iy * iy + iz * iz);
-          FloatType k = kfft * kw;
-
-          // .. logarithmic spacing in k
-          idx = (int) ((1.0f / dklog * log10(k / kmin)));
-
-          // Make sure we don't go outside the bins by mistake:
-          if (k >= kmin && k < kmax) {
-
-            Gx[idx] += vabs; // Sum squares of the field
-            Px[idx] += P0.getFourierCoefficient(ix, iy, iz).real(); // Sum 'exact' values of power spectrum in this bin.
-            kbin[idx] += k; // Sum of k contributing to this bin.
-            inBin[idx]++; // Total number in this bin
-
-          } else { continue; }
-
-        }
-
-
-    // ... convert to comoving units ...
-    std::ofstream ofs(filename);
-    FloatType psnorm =
-      1 / (CAMB<FloatType>::getPowerSpectrumNormalizationForGrid(field.getGrid()));
-    // Pre-v1 this had an extra factor pow((2.0 * M_PI), 3.0), which made it differ from CAMB normalisation
-    // Updated to prevent confusion.
-
-    for (ix = 0; ix < nBins; ix++) {
-
-      if (inBin[ix] > 0) {
-
-
-        ofs << std::setw(16) << pow(10., log10(kmin) + dklog * (ix + 0.5)) // Middle of the k-bin
-            << std::setw(16) << kbin[ix] / inBin[ix] // Average value of k in this bin
-            << std::setw(16)
-            << (FloatType) (Px[ix] / inBin[ix]) * psnorm // Average of exact power spectrum for k in this bin
-            << std::setw(16) << (FloatType) (Gx[ix] / inBin[ix]) *
-                                psnorm // Average of |delta_k|^2 in this bin, ie, estimated power spectrum.
-            << std::setw(16) << inBin[ix] // Number in this bin
-            << std::endl;
-
-      }
-    }
-    ofs.close();
-
-
-  }
-
   //! Convert a density field to a potential field, in-place.
   template<typename DataType, typename FloatType=tools::datatypes::strip_complex<DataType>>
   void densityToPotential(fields::Field<DataType, FloatType> &field, const CosmologicalParameters<FloatType> &cosmo)
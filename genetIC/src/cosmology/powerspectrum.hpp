@@ -0,0 +1,262 @@
+#ifndef IC_POWERSPECTRUM_HPP
+#define IC_POWERSPECTRUM_HPP
+
+#include <omp.h>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include "src/cosmology/camb.hpp"
+#include "src/simulation/field/field.hpp"
+
+namespace cosmology {
+
+  /*! \class PowerSpectrumBinning
+      \brief Assigns the Fourier modes of a grid to k bins for estimating power spectra.
+
+      Bins are spaced evenly in k or in log k, between the fundamental mode of the grid and its Nyquist frequency.
+      Since the bin depends only on |k|, which is a multiple of the fundamental mode by the square root of an integer,
+      the bin for every possible integer |k|^2 is tabulated once when the binning is constructed.
+  */
+  template<typename FloatType>
+  class PowerSpectrumBinning {
+  protected:
+    size_t nBins; //!< Number of k bins
+    bool logarithmic; //!< True if the bins are evenly spaced in log k, false if evenly spaced in k
+    FloatType kmin; //!< Lower edge of the first bin, the fundamental mode of the grid
+    FloatType kmax; //!< Upper edge of the last bin, the Nyquist frequency of the grid
+    FloatType kw; //!< Fundamental mode of the grid
+    FloatType binWidth; //!< Width of each bin, in k or log10 k
+    std::vector<int> binForSquaredWavenumber; //!< Bin for each integer |k|^2, or -1 if outside the binned range
+
+  public:
+    /*! \brief Tabulate the bins for the given grid
+        \param grid - grid whose Fourier modes are to be binned
+        \param nBins - number of k bins
+        \param logarithmic - true to space the bins evenly in log k, false to space them evenly in k
+    */
+    PowerSpectrumBinning(const grids::Grid<FloatType> &grid, size_t nBins, bool logarithmic) :
+      nBins(nBins), logarithmic(logarithmic) {
+      if (nBins == 0)
+        throw std::runtime_error("A power spectrum needs at least one k bin");
+
+      int res = int(grid.size);
+      const FloatType boxLength = grid.thisGridSize;
+      kmax = M_PI / boxLength * (FloatType) res;
+      kmin = 2.0f * M_PI / boxLength;
+      kw = 2.0f * M_PI / boxLength;
+      binWidth = logarithmic ? log10(kmax / kmin) / nBins : (kmax - kmin) / nBins;
+
+      size_t maxSquaredWavenumber = 3 * size_t(res / 2) * size_t(res / 2);
+      binForSquaredWavenumber.resize(maxSquaredWavenumber + 1);
+
+#pragma omp parallel for
+      for (size_t n2 = 0; n2 <= maxSquaredWavenumber; ++n2) {
+        FloatType k = sqrt(FloatType(n2)) * kw;
+        if (k >= kmin && k < kmax) {
+          int bin = logarithmic ? (int) ((1.0f / binWidth * log10(k / kmin))) : (int) ((k - kmin) / binWidth);
+          binForSquaredWavenumber[n2] = std::min(bin, int(nBins) - 1);
+        } else {
+          binForSquaredWavenumber[n2] = -1;
+        }
+      }
+    }
+
+    //! Returns the number of bins
+    size_t getNumBins() const {
+      return nBins;
+    }
+
+    //! Returns the bin for a mode with integer wavenumbers whose squares sum to n2, or -1 if it is not binned
+    int getBinForSquaredWavenumber(size_t n2) const {
+      return n2 < binForSquaredWavenumber.size() ? binForSquaredWavenumber[n2] : -1;
+    }
+
+    //! Returns the fundamental mode of the grid, by which integer wavenumbers are multiplied to give k
+    FloatType getFundamentalMode() const {
+      return kw;
+    }
+
+    //! Returns the k at the middle of the specified bin (in log k for logarithmic bins)
+    FloatType getBinCentre(size_t bin) const {
+      if (logarithmic)
+        return pow(10., log10(kmin) + binWidth * (bin + 0.5));
+      else
+        return kmin + binWidth * (bin + 0.5);
+    }
+  };
+
+
+  /*! \class BinnedFourierSums
+      \brief Sums over the Fourier modes in each k bin of products of fields, all accumulated in a single pass.
+
+      Each requested term is a pair of indices (i, j) into the list of fields, and sums Re(f_i f_j^*), so that (i, i)
+      gives the power in field i and (i, j) the cross-power between fields i and j. A term (i, npos) instead sums
+      Re(f_i) itself, which is used to average a covariance field holding the theory power spectrum.
+
+      The modes are divided between threads, each of which accumulates its own sums; these are combined in thread
+      order at the end so that, for a given number of threads, the result does not depend on scheduling.
+  */
+  template<typename DataType, typename FloatType=tools::datatypes::strip_complex<DataType>>
+  class BinnedFourierSums {
+  public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max(); //!< Second index of a term summing Re(f_i)
+
+    std::vector<FloatType> numberInBin; //!< Number of modes in each bin
+    std::vector<FloatType> sumOfK; //!< Sum of k over the modes in each bin
+    std::vector<std::vector<FloatType>> sumOfTerm; //!< For each term, its sum over the modes in each bin
+
+    /*! \brief Accumulate the sums
+        \param binning - the bins to use, which must have been constructed for the grid of the fields
+        \param fields - the fields (all on the same grid), which must be in Fourier space
+        \param terms - the terms to sum, as described for the class
+    */
+    BinnedFourierSums(const PowerSpectrumBinning<FloatType> &binning,
+                      const std::vector<const fields::Field<DataType> *> &fields,
+                      const std::vector<std::pair<size_t, size_t>> &terms) {
+      const size_t nBins = binning.getNumBins();
+      const int res = int(fields[0]->getGrid().size);
+      for (auto field : fields) {
+        if (int(field->getGrid().size) != res)
+          throw std::runtime_error("Fields for a power spectrum estimate must share a grid size");
+        field->ensureFourierModesAreMirrored();
+      }
+
+      const int nThreads = omp_get_max_threads();
+      std::vector<std::vector<FloatType>> threadNumberInBin(nThreads, std::vector<FloatType>(nBins, 0));
+      std::vector<std::vector<FloatType>> threadSumOfK(nThreads, std::vector<FloatType>(nBins, 0));
+      std::vector<std::vector<std::vector<FloatType>>> threadSumOfTerm(
+        nThreads, std::vector<std::vector<FloatType>>(terms.size(), std::vector<FloatType>(nBins, 0)));
+
+#pragma omp parallel num_threads(nThreads)
+      {
+        const int thread = omp_get_thread_num();
+        auto &localNumberInBin = threadNumberInBin[thread];
+        auto &localSumOfK = threadSumOfK[thread];
+        auto &localSumOfTerm = threadSumOfTerm[thread];
+        std::vector<tools::datatypes::ensure_complex<DataType>> values(fields.size());
+
+#pragma omp for schedule(static)
+        for (int ix = -res / 2; ix < res / 2 + 1; ix++) {
+          for (int iy = -res / 2; iy < res / 2 + 1; iy++) {
+            for (int iz = -res / 2; iz < res / 2 + 1; iz++) {
+              size_t n2 = size_t(ix * ix + iy * iy + iz * iz);
+              int bin = binning.getBinForSquaredWavenumber(n2);
+              if (bin < 0)
+                continue;
+
+              for (size_t i = 0; i < fields.size(); ++i)
+                values[i] = fields[i]->getFourierCoefficient(ix, iy, iz);
+
+              for (size_t t = 0; t < terms.size(); ++t) {
+                const auto &a = values[terms[t].first];
+                if (terms[t].second == npos)
+                  localSumOfTerm[t][bin] += a.real();
+                else
+                  localSumOfTerm[t][bin] += (a * std::conj(values[terms[t].second])).real();
+              }
+
+              localSumOfK[bin] += sqrt(FloatType(n2)) * binning.getFundamentalMode();
+              localNumberInBin[bin]++;
+            }
+          }
+        }
+      }
+
+      numberInBin.assign(nBins, 0);
+      sumOfK.assign(nBins, 0);
+      sumOfTerm.assign(terms.size(), std::vector<FloatType>(nBins, 0));
+      for (int thread = 0; thread < nThreads; ++thread) {
+        for (size_t bin = 0; bin < nBins; ++bin) {
+          numberInBin[bin] += threadNumberInBin[thread][bin];
+          sumOfK[bin] += threadSumOfK[thread][bin];
+          for (size_t t = 0; t < terms.size(); ++t)
+            sumOfTerm[t][bin] += threadSumOfTerm[thread][t][bin];
+        }
+      }
+    }
+  };
+
+
+  //! \brief Dump an estimated power spectrum for the field, alongside the specified theory power spectrum, to disk
+  /*!
+   * The power spectrum is estimated by assigning the Fourier modes of the field to k bins according to
+   * k = \sqrt{kx^2 + ky^2 + kz^2}, and taking the average of |\delta_k|^2 in each bin. The columns written are the
+   * centre of the bin, the average k of the modes in it, the average theory power spectrum, the estimated power
+   * spectrum and the number of modes.
+   */
+  template<typename DataType, typename FloatType=tools::datatypes::strip_complex<DataType>>
+  void dumpPowerSpectrum(const fields::Field<DataType> &field,
+                         const fields::Field<DataType> &P0, const std::string &filename,
+                         size_t nBins = 100, bool logarithmic = true) {
+
+    PowerSpectrumBinning<FloatType> binning(field.getGrid(), nBins, logarithmic);
+    BinnedFourierSums<DataType> sums(binning, {&field, &P0}, {{0, 0}, {1, BinnedFourierSums<DataType>::npos}});
+    const auto &Gx = sums.sumOfTerm[0]; // Sum of |\delta_k|^2 in each bin
+    const auto &Px = sums.sumOfTerm[1]; // Sum of 'exact' values of the power spectrum in each bin
+
+    // ... convert to comoving units ...
+    std::ofstream ofs(filename);
+    FloatType psnorm =
+      1 / (CAMB<FloatType>::getPowerSpectrumNormalizationForGrid(field.getGrid()));
+    // Pre-v1 this had an extra factor pow((2.0 * M_PI), 3.0), which made it differ from CAMB normalisation
+    // Updated to prevent confusion.
+
+    for (size_t ix = 0; ix < nBins; ix++) {
+      FloatType inBin = sums.numberInBin[ix];
+      if (inBin > 0) {
+        ofs << std::setw(16) << binning.getBinCentre(ix) // Middle of the k-bin
+            << std::setw(16) << sums.sumOfK[ix] / inBin // Average value of k in this bin
+            << std::setw(16)
+            << (FloatType) (Px[ix] / inBin) * psnorm // Average of exact power spectrum for k in this bin
+            << std::setw(16) << (FloatType) (Gx[ix] / inBin) *
+                                psnorm // Average of |delta_k|^2 in this bin, ie, estimated power spectrum.
+            << std::setw(16) << inBin // Number in this bin
+            << std::endl;
+      }
+    }
+  }
+
+  //! \brief Dump the power spectra of two fields on the same grid, and the cross-spectrum between them, to disk
+  /*!
+   * The spectra are estimated as for dumpPowerSpectrum, all in a single pass over the Fourier modes. The columns
+   * written are the centre of the bin, the average k of the modes in it, the power spectrum of each field, their
+   * cross-spectrum, the correlation coefficient P_ab / sqrt(P_a P_b) and the number of modes.
+   */
+  template<typename DataType, typename FloatType=tools::datatypes::strip_complex<DataType>>
+  void dumpCrossPowerSpectrum(const fields::Field<DataType> &fieldA, const fields::Field<DataType> &fieldB,
+                              const std::string &filename, size_t nBins = 100, bool logarithmic = true) {
+
+    PowerSpectrumBinning<FloatType> binning(fieldA.getGrid(), nBins, logarithmic);
+    BinnedFourierSums<DataType> sums(binning, {&fieldA, &fieldB}, {{0, 0}, {1, 1}, {0, 1}});
+
+    std::ofstream ofs(filename);
+    FloatType psnorm =
+      1 / (CAMB<FloatType>::getPowerSpectrumNormalizationForGrid(fieldA.getGrid()));
+
+    for (size_t ix = 0; ix < nBins; ix++) {
+      FloatType inBin = sums.numberInBin[ix];
+      if (inBin > 0) {
+        FloatType powerA = sums.sumOfTerm[0][ix] / inBin * psnorm;
+        FloatType powerB = sums.sumOfTerm[1][ix] / inBin * psnorm;
+        FloatType crossPower = sums.sumOfTerm[2][ix] / inBin * psnorm;
+        FloatType correlation = powerA > 0 && powerB > 0 ? crossPower / sqrt(powerA * powerB) : 0;
+
+        ofs << std::setw(16) << binning.getBinCentre(ix) // Middle of the k-bin
+            << std::setw(16) << sums.sumOfK[ix] / inBin // Average value of k in this bin
+            << std::setw(16) << powerA
+            << std::setw(16) << powerB
+            << std::setw(16) << crossPower
+            << std::setw(16) << correlation
+            << std::setw(16) << inBin // Number in this bin
+            << std::endl;
+      }
+    }
+  }
+
+}
+
+#endif
@@ -71,6 +71,12 @@ public:
   //! Calls to this function has no effect in a dummy IC generator, since it is only working out the mapper structure
   void dumpPS(size_t, particle::species) override {}
 
+  //! Calls to this function has no effect in a dummy IC generator, since it is only working out the mapper structure
+  void dumpCrossPSSpecies(size_t) override {}
+
+  //! Calls to this function has no effect in a dummy IC generator, since it is only working out the mapper structure
+  void dumpCrossPSLevels(size_t) override {}
+
   //! Calls to this function has no effect in a dummy IC generator, since it is only working out the mapper structure
   void dumpMask() override {}
 
@@ -101,6 +107,12 @@ public:
   //! Calls to this function has no effect in a dummy IC generator, since it is only working out the mapper structure
   void reverseSmallK(T /*kmax*/) override {}
 
+  //! Calls to this function has no effect in a dummy IC generator, since it is only working out the mapper structure
+  void checkpoint(std::string /*filename*/) override {}
+
+  //! Calls to this function has no effect in a dummy IC generator, since it is only working out the mapper structure
+  void resumeModificationsAndFields(io::checkpoint::Reader<GridDataType> & /*in*/) override {}
+
   //! Calls to this function has no effect in a dummy IC generator, since it is only working out the mapper structure
   void importLevel(size_t /*level*/, std::string /*filename*/) override {}
 
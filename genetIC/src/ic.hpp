@@ -10,14 +10,19 @@
 #include <limits>
 #include <iostream>
 #include <list>
+#include <set>
 
 
 #include "tools/numerics/vectormath.hpp"
 #include "tools/numerics/fourier.hpp"
 #include "tools/filesystem.h"
 #include "io/numpy.hpp"
+#include "io/ids.hpp"
+#include "io/checkpoint.hpp"
+#include "io/cache.hpp"
 #include "cosmology/parameters.hpp"
 #include "cosmology/camb.hpp"
+#include "cosmology/powerspectrum.hpp"
 #include "simulation/window.hpp"
 #include "simulation/particles/species.hpp"
 #include "simulation/multilevelgrid/multilevelgrid.hpp"
@@ -33,6 +38,7 @@
 #include "simulation/particles/mapper/graficmapper.hpp"
 #include "simulation/particles/offsetgenerator.hpp"
 #include "tools/logging.hpp"
+#include "tools/profiling.hpp"
 
 using namespace std;
 
@@ -66,6 +72,23 @@ protected:
   modifications::ModificationManager<GridDataType> modificationManager; //!< Handles applying modificaitons to the various fields.
   std::unique_ptr<fields::RandomFieldGenerator<GridDataType>> randomFieldGenerator; //!< Generate white noise for the output fields
   std::unique_ptr<cosmology::PowerSpectrum<GridDataType>> spectrum; //!< Transfer function data
+  std::string cambFilePath; //!< Absolute path of the CAMB file the transfer function was read from, if any
+  T powerLawAmplitude = 0; //!< Amplitude of the power-law spectrum, if one is in use instead of a CAMB file
+
+  /*! \struct ModificationDefinition
+      \brief Everything needed to re-create a modification in the list, used when writing checkpoints.
+  */
+  struct ModificationDefinition {
+    std::string name;
+    T target; //!< Absolute target
+    int initialNumberSteps;
+    T precision;
+    T filterScale;
+    std::vector<std::vector<size_t>> flaggedCells; //!< Cells on each level flagged when the modification was defined
+  };
+
+  //! Definitions of the modifications currently in modificationManager's list
+  std::vector<ModificationDefinition> modificationDefinitions;
 
   //! Velocity offset to be added uniformly to output (default 0,0,0)
   Coordinate<GridDataType> velOffset;
@@ -91,14 +114,29 @@ protected:
   //! Normalisation used for cell softening scale:
   T epsNorm = 0.01075; // Default value arbitrary to coincide with normal UW resolution
 
+  //! If true, Zeldovich offsets are calculated a component at a time and stored in single precision, to save memory
+  bool leanZeldovich = false;
+
 
-  io::OutputFormat outputFormat = io::OutputFormat::unknown; //!< Output format used by the code for particle data.
+  io::OutputFormat outputFormat = io::OutputFormat::unknown; //!< Output format the particle mapper is set up for.
+  std::vector<io::OutputFormat> outputFormats; //!< All output formats written by write(), starting with outputFormat
   string outputFolder; //!< Name of folder for output files.
   string outputFilename; //!< Name of files for output.
+  string outputSuffix; //!< Appended to the name of output files, to distinguish the realisations in a batch
+
+  size_t powerSpectrumBins = 100; //!< Number of k bins used by dump_ps and the cross-spectrum dumps
+  bool powerSpectrumLogBins = true; //!< If true, power spectrum bins are evenly spaced in log k rather than k
+
+  std::vector<unsigned long> batchSeeds; //!< If not empty, done() generates and writes one realisation for each seed
+  bool alsoOutputReversed = false; //!< In a batch, also write each realisation with the sign of its white noise reversed
+  bool pairedOutput = false; //!< If true, write() also writes the ICs from the sign-flipped field
 
   //! Track whether the random realisation has yet been made
   bool haveInitialisedRandomComponent;
 
+  //! True once a modification has been defined in a batch, after which the grids must not change (see modify)
+  bool gridLayoutFrozen = false;
+
   //! Enforce the exact power spectrum, as in Angulo & Pontzen 2016
   bool exactPowerSpectrum;
 
@@ -286,6 +324,16 @@ public:
     this->epsNorm = in;
   }
 
+  //! Calculate the Zeldovich offsets a component at a time, and store them in single precision
+  /*! This roughly halves the peak memory used in generating particles. The output is unchanged up to single-precision
+   * rounding, which is below the precision of the tipsy and gadget outputs.
+   */
+  void setLeanZeldovich() {
+    if (!pParticleGenerator.empty())
+      throw std::runtime_error("lean_zeldovich must be set before the particles are generated");
+    leanZeldovich = true;
+  }
+
   //! Add a higher resolution grid to the stack by supersampling the finest grid.
   /*! The power spectrum will not be taken into account in this grid
    * \param factor Factor by which the resolution must be increased compared to the finest grid
@@ -357,7 +405,7 @@ public:
       throw std::runtime_error("Cannot re-initialize the base grid");
 
 
-    if (haveInitialisedRandomComponent) {
+    if (haveInitialisedRandomComponent || gridLayoutFrozen) {
       throw (std::runtime_error("Trying to initialize a grid after the random field was already drawn"));
     }
 
@@ -384,7 +432,7 @@ public:
    * \param n Number of cells in the zoom grid
    */
   void initZoomGrid(size_t zoomfac, size_t n) {
-    if (haveInitialisedRandomComponent) {
+    if (haveInitialisedRandomComponent || gridLayoutFrozen) {
       throw (std::runtime_error("Trying to initialize a grid after the random field was already drawn"));
     }
 
@@ -651,6 +699,31 @@ public:
     randomFieldGenerator->setParallel(false);
   }
 
+  /*! \brief Generate a batch of realisations, one for each of the given seeds, instead of a single one.
+   *
+   * The realisations are all generated by done(), using the algorithm chosen by the preceding random_seed command,
+   * and are written with the seed appended to the output filename. Everything that does not depend on the seed (the
+   * grids, particle mapper, covariances and modifications) is set up only once.
+   */
+  void setBatchSeeds(tools::ArgumentList<unsigned long> seeds) {
+    batchSeeds = seeds;
+  }
+
+  //! In a batch, also write each realisation with the sign of its white noise reversed (before any modifications)
+  void setAlsoOutputReversed() {
+    alsoOutputReversed = true;
+  }
+
+  /*! \brief After writing the ICs, also write those from the sign-flipped field, with "_paired" appended to their name.
+   *
+   * Together with fix_power, this gives a paired-and-fixed realisation in a single run. Unlike also_output_reversed,
+   * the sign is flipped after any modifications, so the mapper, covariances and Zeldovich offsets are all reused;
+   * the modified quantities are reversed too.
+   */
+  void setPairedOutput() {
+    pairedOutput = true;
+  }
+
   //! Enables exact power spectrum enforcement.
   void setExactPowerSpectrumEnforcement() {
     exactPowerSpectrum = true;
@@ -689,12 +762,18 @@ public:
   void setCambDat(std::string cambFilePath) {
     spectrum = std::make_unique<cosmology::CAMB<GridDataType>>(this->cosmology, cambFilePath);
     this->multiLevelContext.setPowerspectrumGenerator(*spectrum);
+
+    // Record the absolute path, so that a checkpoint can refer to it relative to its own location
+    this->cambFilePath = tools::getAbsolutePath(cambFilePath);
+    this->powerLawAmplitude = 0;
   }
 
   //! \brief Use a power law spectrum with specified amplitude
   void setPowerLawAmplitude(T amplitude) {
     spectrum = std::make_unique<cosmology::PowerLawPowerSpectrum<GridDataType>>(this->cosmology, amplitude);
     this->multiLevelContext.setPowerspectrumGenerator(*spectrum);
+    this->cambFilePath.clear();
+    this->powerLawAmplitude = amplitude;
   }
 
   //! Set the ouput directory to the supplied string
@@ -702,6 +781,27 @@ public:
     outputFolder = outputPath;
   }
 
+  /*! \brief Store large, rarely used fields (cached covariances and the baryon output field) in files in the given
+   * directory, which should be on fast local disk, rather than in RAM.
+   *
+   * The files are mem-mapped and deleted automatically; the operating system keeps the parts in active use in memory.
+   */
+  void setStorageDirectory(std::string path) {
+    tools::storage::setBackingDirectory(path);
+    logging::entry() << "Rarely used fields will be backed by files in " << path << std::endl;
+  }
+
+  /*! \brief Keep white noise draws, covariances and splice solutions in the given directory, and reuse them in
+   * later runs with the same inputs.
+   *
+   * Entries are named by a hash of everything that determined them, so the directory can be shared between runs of
+   * different parameter files. It should be emptied after upgrading the code.
+   */
+  void setCacheDirectory(std::string path) {
+    io::cache::setDirectory(path);
+    logging::entry() << "Expensive intermediate results will be cached in " << path << std::endl;
+  }
+
   //! Sets prefix for the name of all output files.
   void setOutName(std::string outputFilename_) {
     outputFilename = outputFilename_;
@@ -709,10 +809,30 @@ public:
 
   //! Set formats from handled formats in io namespace
   void setOutputFormat(io::OutputFormat format) {
+    outputFormats = {format};
     outputFormat = format;
     updateParticleMapper();
   }
 
+  /*! \brief Set one or more output formats, e.g. "outformat gadget3 tipsy".
+   *
+   * All formats are written from the same particle generators, so the Zeldovich offsets are only computed once.
+   * The particle mapper is set up for the first format given.
+   */
+  void setOutputFormats(tools::ArgumentList<io::OutputFormat> formats) {
+    for (size_t i = 0; i < formats.size(); ++i) {
+      for (size_t j = 0; j < i; ++j) {
+        bool bothGadget = (formats[i] == io::OutputFormat::gadget2 || formats[i] == io::OutputFormat::gadget3) &&
+                          (formats[j] == io::OutputFormat::gadget2 || formats[j] == io::OutputFormat::gadget3);
+        if (formats[i] == formats[j] || bothGadget)
+          throw std::runtime_error("Each output format can only be given once, and gadget2 and gadget3 cannot "
+                                   "be combined since they write to the same files");
+      }
+    }
+    setOutputFormat(formats[0]);
+    outputFormats = formats;
+  }
+
   //! Returns the directory currently used for output.
   string getOutputPath() {
     ostringstream fname_stream;
@@ -722,6 +842,7 @@ public:
     } else {
       fname_stream << outputFolder << "/" << outputFilename;
     }
+    fname_stream << outputSuffix;
     return fname_stream.str();
   }
 
@@ -792,9 +913,14 @@ public:
     assert(outputFields.size()==1);
 
     if(useBaryonTransferFunction) {
-      // make a copy of the white noise field:
-      outputFields.emplace_back(std::make_shared<fields::OutputField<GridDataType>>(*outputFields[0]));
+      // make a copy of the white noise field; it is only needed again for gas output, so may live in the backing store
+      {
+        tools::storage::UseBackingStore useBackingStore;
+        outputFields.emplace_back(std::make_shared<fields::OutputField<GridDataType>>(*outputFields[0]));
+      }
       outputFields[1]->applyPowerSpectrumFor(particle::species::baryon);
+      for (size_t level = 0; level < outputFields[1]->getNumLevels(); ++level)
+        outputFields[1]->getFieldForLevel(level).adviseRarelyUsed();
       outputFields[0]->applyPowerSpectrumFor(particle::species::dm);
     } else {
       outputFields[0]->applyPowerSpectrumFor(particle::species::all);
@@ -922,7 +1048,61 @@ public:
 
     cosmology::dumpPowerSpectrum(field,
                                  *multiLevelContext.getCovariance(level, species),
-                                 filename.c_str());
+                                 filename.c_str(), powerSpectrumBins, powerSpectrumLogBins);
+  }
+
+  //! Dumps the power spectra of dark matter and baryons at a given level, and their cross-spectrum, to a .ps file
+  virtual void dumpCrossPSSpecies(size_t level) {
+    if (!useBaryonTransferFunction)
+      throw std::runtime_error("The dark matter/baryon cross-spectrum requires baryon_tf_on");
+
+    auto &dmField = getOutputFieldForSpecies(particle::species::dm).getFieldForLevel(level);
+    auto &baryonField = getOutputFieldForSpecies(particle::species::baryon).getFieldForLevel(level);
+    dmField.toFourier();
+    baryonField.toFourier();
+
+    cosmology::dumpCrossPowerSpectrum(dmField, baryonField,
+                                      getOutputPath() + "_" + std::to_string(level) + "_dm_baryons.ps",
+                                      powerSpectrumBins, powerSpectrumLogBins);
+  }
+
+  //! Dumps the power spectra of a level and the next finer level, and their cross-spectrum, to a .ps file
+  /*!
+   * The coarser field is interpolated onto the grid of the finer one, so that the spectra are all estimated over
+   * the region covered by the finer level.
+   */
+  virtual void dumpCrossPSLevels(size_t level) {
+    if (level + 1 >= multiLevelContext.getNumLevels())
+      throw std::runtime_error("The cross-spectrum between levels requires a finer level than level "
+                               + std::to_string(level));
+
+    auto &outputField = getOutputFieldForSpecies(particle::species::dm);
+    auto &coarseField = outputField.getFieldForLevel(level);
+    auto &fineField = outputField.getFieldForLevel(level + 1);
+
+    coarseField.toReal();
+    fields::Field<GridDataType, T> coarseFieldOnFineGrid(multiLevelContext.getGridForLevel(level + 1), false);
+    coarseFieldOnFineGrid.addFieldFromDifferentGrid(coarseField);
+    coarseFieldOnFineGrid.toFourier();
+    fineField.toFourier();
+
+    cosmology::dumpCrossPowerSpectrum(coarseFieldOnFineGrid, fineField,
+                                      getOutputPath() + "_" + std::to_string(level) + "_"
+                                      + std::to_string(level + 1) + ".ps",
+                                      powerSpectrumBins, powerSpectrumLogBins);
+  }
+
+  //! Sets the number of k bins, and whether they are spaced logarithmically ("log") or linearly ("linear"), for dump_ps
+  void setPowerSpectrumBinning(size_t nBins, std::string spacing) {
+    if (nBins == 0)
+      throw std::runtime_error("The number of power spectrum bins must be positive");
+    if (spacing == "log")
+      powerSpectrumLogBins = true;
+    else if (spacing == "linear")
+      powerSpectrumLogBins = false;
+    else
+      throw std::runtime_error("Power spectrum bin spacing must be either 'log' or 'linear'");
+    powerSpectrumBins = nBins;
   }
 
   //! For backwards compatibility. Dumps dark matter power spectrum on the requested level.
@@ -988,7 +1168,8 @@ public:
     using OffsetGeneratorType = particle::OffsetMultiLevelParticleGenerator<GridDataType>;
 
     pParticleGenerator[species] = std::make_shared<
-      particle::MultiLevelParticleGenerator<GridDataType, GridLevelGeneratorType>>(field, cosmology, epsNorm);
+      particle::MultiLevelParticleGenerator<GridDataType, GridLevelGeneratorType>>(field, cosmology, epsNorm,
+                                                                                    leanZeldovich);
 
     Coordinate<GridDataType> posOffset;
 
@@ -1091,6 +1272,8 @@ public:
   * changed, this needs to be accounted for. It should be called whenever such a change has been made.
   */
   void updateParticleMapper() {
+    tools::profiling::ScopedTimer timer("mapper_construction");
+
     // TODO: This routine contains too much format-dependent logic and should be refactored so that the knowledge
     // resides somewhere in the io namespace
 
@@ -1225,15 +1408,67 @@ public:
   }
 
 
-  //! Outputs the ICs in the defined format, creating appropriate particle generators if required
+  //! Outputs the ICs in each of the defined formats, creating appropriate particle generators if required
   virtual void write() {
-    using namespace io;
-
     initialiseRandomComponentIfUninitialised();
     applyPowerSpec();
     ensureParticleGeneratorInitialised();
 
-    logging::entry() << "Writing output; number dm particles=" << pMapper->size_dm()
+    writeAllFormats();
+
+    if (pairedOutput) {
+      logging::entry() << "Writing the paired ICs, from the sign-flipped field" << endl;
+      reverseFieldsAndParticleGenerators();
+      std::string originalSuffix = outputSuffix;
+      outputSuffix += "_paired";
+      writeAllFormats();
+      outputSuffix = originalSuffix;
+
+      // Negation is exact, so this restores the original field for any commands that follow
+      reverseFieldsAndParticleGenerators();
+    }
+
+    logging::entry() << "Finished writing initial conditions" << endl;
+
+  }
+
+  //! Flips the sign of the output fields and of the offsets already calculated by the particle generators
+  void reverseFieldsAndParticleGenerators() {
+    for (auto &pField : outputFields)
+      pField->reverse();
+
+    // Species may share a generator, which must only be reversed once
+    std::set<particle::AbstractMultiLevelParticleGenerator<GridDataType> *> reversed;
+    for (auto &speciesAndGenerator : pParticleGenerator) {
+      if (reversed.insert(speciesAndGenerator.second.get()).second)
+        speciesAndGenerator.second->reverse();
+    }
+  }
+
+  //! Outputs the ICs in each of the defined formats
+  void writeAllFormats() {
+    // The particle generators are shared between formats; only the particle mapper depends on the format, so that
+    // it is rebuilt for each additional format and then restored for any commands that follow
+    io::OutputFormat originalFormat = outputFormat;
+    for (auto format : outputFormats) {
+      if (format != outputFormat) {
+        outputFormat = format;
+        updateParticleMapper();
+      }
+      writeInCurrentFormat();
+    }
+
+    if (outputFormat != originalFormat) {
+      outputFormat = originalFormat;
+      updateParticleMapper();
+    }
+  }
+
+  //! Outputs the ICs in the format the particle mapper is currently set up for
+  void writeInCurrentFormat() {
+    using namespace io;
+
+    logging::entry() << "Writing " << outputFormat << " output; number dm particles=" << pMapper->size_dm()
          << ", number gas particles=" << pMapper->size_gas() << endl;
 #ifdef DEBUG_INFO
     logging::entry() << (*pMapper);
@@ -1269,9 +1504,6 @@ public:
       default:
         throw std::runtime_error("Unknown output format");
     }
-
-    logging::entry() << "Finished writing initial conditions" << endl;
-
   }
 
   //! Initialise random components for all the fields.
@@ -1332,14 +1564,14 @@ protected:
   //! Loads flagged particles from a file, erases and duplicates, and then flags these particles.
   /*!
   * Note that this function does not erase existing flags - for that purpose, loadParticleIdFile should
-  * be called instead.
+  * be called instead. The file may be text, raw binary (.bin) or numpy (.npy); see io::ids.
   */
   void appendParticleIdFile(std::string filename) {
 #ifdef DEBUG_INFO
     logging::entry() << "Loading " << filename << endl;
 #endif
     std::vector<size_t> flaggedParticles;
-    io::getBuffer(flaggedParticles, filename);
+    io::ids::load(filename, flaggedParticles);
     tools::sortAndEraseDuplicate(flaggedParticles);
 
     flagCellsCorrespondingToParticles(flaggedParticles);
@@ -1371,7 +1603,7 @@ public:
     getCentre();
   }
 
-  //! Output to a file the currently flagged particles
+  //! Output to a file the currently flagged particles, as text, raw binary (.bin) or numpy (.npy)
   virtual void dumpID(string fname) {
     std::vector<size_t> results;
 #ifdef DEBUG_INFO
@@ -1379,7 +1611,7 @@ public:
     logging::entry() << (*pMapper);
 #endif
     pMapper->getFlaggedParticles(results);
-    io::dumpBuffer(results, fname);
+    io::ids::save(fname, results);
   }
 
   //! Defines the currently interesting coordinates using a particle ID
@@ -1399,10 +1631,13 @@ public:
   }
 
   //! Selects particles to flag according to a specified function of their co-ordinate.
-  void select(std::function<bool(T, T, T)> inclusionFunction) {
-    T delta_x, delta_y, delta_z;
-    T xp, yp, zp;
-
+  /*!
+   * \param inclusionFunction - returns true if a cell with the given wrapped offset from (x0,y0,z0) is to be flagged
+   * \param boundingHalfExtent - half-size of a box, centred on (x0,y0,z0), outside which inclusionFunction is always
+   *                             false. Only cells within this box are tested. By default the whole domain is tested.
+   */
+  void select(std::function<bool(T, T, T)> inclusionFunction,
+              Coordinate<T> boundingHalfExtent = Coordinate<T>(std::numeric_limits<T>::max())) {
     // unflag all grids first. This can't be in the loop below in case there are subtle
     // relationships between grids (in particular the ResolutionMatchingGrid which actually
     // points to two levels simultaneously).
@@ -1413,17 +1648,8 @@ public:
     for (size_t level = 0; level < multiLevelContext.getNumLevels(); ++level) {
       std::vector<size_t> particleArray;
       auto grid = getOutputGrid(level);
-      size_t N = grid->size3;
-      for (size_t i = 0; i < N; i++) {
-        std::tie(xp, yp, zp) = grid->getCentroidFromIndex(i);
-        delta_x = get_wrapped_delta(xp, x0);
-        delta_y = get_wrapped_delta(yp, y0);
-        delta_z = get_wrapped_delta(zp, z0);
-        if (inclusionFunction(delta_x, delta_y, delta_z))
-          particleArray.push_back(i);
-      }
+      grid->appendIdsInRegion(Coordinate<T>(x0, y0, z0), boundingHalfExtent, inclusionFunction, particleArray);
       grid->flagCells(particleArray);
-
     }
   }
 
@@ -1436,7 +1662,7 @@ public:
     select([r2](T delta_x, T delta_y, T delta_z) -> bool {
       T r2_i = delta_x * delta_x + delta_y * delta_y + delta_z * delta_z;
       return r2_i < r2;
-    });
+    }, Coordinate<T>(radius));
 
   }
 
@@ -1452,7 +1678,7 @@ public:
     select([a2, b2, c2](T delta_x, T delta_y, T delta_z) -> bool {
       T r2_i = delta_x * delta_x / a2 + delta_y * delta_y / b2 + delta_z * delta_z / c2;
       return r2_i < 1.;
-    });
+    }, Coordinate<T>(std::abs(a), std::abs(b), std::abs(c)));
 
   } 
 
@@ -1464,7 +1690,7 @@ public:
     T side_by_2 = side / 2;
     select([side_by_2](T delta_x, T delta_y, T delta_z) -> bool {
       return abs(delta_x) < side_by_2 && abs(delta_y) < side_by_2 && abs(delta_z) < side_by_2;
-    });
+    }, Coordinate<T>(std::abs(side_by_2)));
   }
 
   //! Expand the current flagged region by the specified number of cells
@@ -1555,21 +1781,32 @@ public:
    * @param target Absolute target or factor by which the existing will be multiplied
    */
   virtual void modify(string name, string type, float target) {
-    initialiseRandomComponentIfUninitialised();
-    // needed for relative modifications where a current value will be evaluated
+    // needed for relative modifications where a current value will be evaluated, and so that the grids cannot
+    // change once a modification is defined. In a batch, the fields are only drawn by done(), so absolute
+    // modifications just freeze the grids.
+    if (batchSeeds.empty() || modificationManager.isRelative(type))
+      initialiseRandomComponentIfUninitialised();
+    else
+      gridLayoutFrozen = true;
 
-    modificationManager.addModificationToList(name, type, target, this->initial_number_steps, this->precision,
-                                              this->variance_filterscale);
+    auto modification = modificationManager.addModificationToList(name, type, target, this->initial_number_steps,
+                                                                  this->precision, this->variance_filterscale);
+    modificationDefinitions.push_back({name, modification->getTarget(), this->initial_number_steps, this->precision,
+                                       this->variance_filterscale, modification->getFlaggedCells()});
   }
 
   //! Empty modification list
   void clearModifications() {
     modificationManager.clearModifications();
+    modificationDefinitions.clear();
   }
 
   //! Apply the algorithm to produce the modified field
   virtual void applyModifications() {
     modificationManager.applyModifications(); // This handles propagating the modifications to the other fields too.
+
+    // The field now satisfies the modifications, so a checkpoint must not ask for them to be solved again on resume
+    modificationDefinitions.clear();
   }
 
 
@@ -1583,6 +1820,11 @@ public:
       throw (std::runtime_error("No output format specified!"));
     }
 
+    if (!batchSeeds.empty()) {
+      writeBatch();
+      return;
+    }
+
     initialiseRandomComponentIfUninitialised();
 
     if (modificationManager.hasModifications())
@@ -1623,9 +1865,28 @@ public:
     for(size_t level=0; level<multiLevelContext.getNumLevels(); ++level) {
       auto &originalFieldThisLevel = outputFields[0]->getFieldForLevel(level);
       auto &newFieldThisLevel = newField.getFieldForLevel(level);
-      auto splicedFieldThisLevel = modifications::spliceOneLevel(newFieldThisLevel, originalFieldThisLevel,
-                                                             *multiLevelContext.getCovariance(level, particle::species::all));
-      splicedFieldThisLevel.toFourier();
+
+      // The solution is fully determined by the two fields, the spliced region and the covariance
+      io::cache::Hasher hash("splice");
+      if (io::cache::isEnabled()) {
+        const auto &grid = multiLevelContext.getGridForLevel(level);
+        std::vector<size_t> flaggedCells;
+        grid.getFlaggedCells(flaggedCells);
+        hash.addField(newFieldThisLevel).addField(originalFieldThisLevel).add(flaggedCells)
+          .add(spectrum->getHashForGrid(grid, particle::species::all));
+      }
+
+      fields::Field<GridDataType, T> splicedFieldThisLevel(originalFieldThisLevel.getGrid(), true);
+      bool fourier;
+      if (io::cache::load<GridDataType>(hash, splicedFieldThisLevel.getDataVector(), fourier)) {
+        logging::entry() << "Loaded splice solution for level " << level << " from cache" << endl;
+        splicedFieldThisLevel.setFourier(fourier);
+      } else {
+        splicedFieldThisLevel = modifications::spliceOneLevel(newFieldThisLevel, originalFieldThisLevel,
+                                                              *multiLevelContext.getCovariance(level, particle::species::all));
+        splicedFieldThisLevel.toFourier();
+        io::cache::save<GridDataType>(hash, splicedFieldThisLevel.getDataVector(), true);
+      }
       originalFieldThisLevel = std::move(splicedFieldThisLevel);
     }
   }
@@ -1651,6 +1912,295 @@ public:
     }
   }
 
+  /*! \brief Save the state of the generator to a binary file, from which it can later be restored with resume.
+   *
+   * The checkpoint includes the cosmology and spectrum, the grid layout, cell flags and zoom masks, the list of
+   * modifications and the white noise field on all levels. Output settings are not included, so that a run can be
+   * resumed several times to write different outputs. The random field is drawn first if this has not yet happened.
+   */
+  virtual void checkpoint(std::string filename) {
+    if (multiLevelContext.getNumLevels() == 0)
+      throw std::runtime_error("Cannot write a checkpoint before initialising the base grid");
+
+    initialiseRandomComponentIfUninitialised();
+
+    if (outputFields.size() > 1 || outputFields[0]->getTransferType() != particle::species::whitenoise)
+      throw std::runtime_error("Cannot write a checkpoint after the power spectrum has been applied; "
+                               "try moving the checkpoint command before done");
+
+    logging::entry() << "Writing checkpoint to " << filename << endl;
+    io::checkpoint::Writer<GridDataType> out(filename);
+
+    // The transfer function file is recorded relative to the checkpoint, so that the two can be moved together
+    std::string checkpointDirectory = tools::getAbsolutePath(tools::getDirectoryName(filename));
+    bool canBeMadeRelative = !cambFilePath.empty() && cambFilePath[0] == '/' && checkpointDirectory[0] == '/';
+
+    out.write(cosmology);
+    out.write(canBeMadeRelative ? tools::getRelativePath(cambFilePath, checkpointDirectory) : cambFilePath);
+    out.write(powerLawAmplitude);
+
+    out.write(useBaryonTransferFunction);
+    out.write(velOffset.x);
+    out.write(velOffset.y);
+    out.write(velOffset.z);
+    out.write(gadgetTypesForLevels);
+    out.write(flaggedParticlesHaveDifferentGadgetType);
+    out.write(flaggedGadgetParticleType);
+    out.write(supersample);
+    out.write(supersampleGas);
+    out.write(subsample);
+    out.write(epsNorm);
+    out.write(exactPowerSpectrum);
+    out.write(allowStrayParticles);
+    out.write(centerOnTargetRegion);
+    out.write(baryonsOnAllLevels);
+    out.write(autopad);
+    out.write(x0);
+    out.write(y0);
+    out.write(z0);
+    out.write(pvarValue);
+    out.write(variance_filterscale);
+    out.write(initial_number_steps);
+    out.write(precision);
+
+    size_t nLevels = multiLevelContext.getNumLevels();
+    out.write(nLevels);
+    for (size_t level = 0; level < nLevels; ++level) {
+      const grids::Grid<T> &grid = multiLevelContext.getGridForLevel(level);
+      out.write(grid.thisGridSize);
+      out.write(grid.size);
+      out.write(grid.offsetLower.x);
+      out.write(grid.offsetLower.y);
+      out.write(grid.offsetLower.z);
+    }
+
+    out.write(zoomParticleArray);
+
+    for (size_t level = 0; level < nLevels; ++level) {
+      std::vector<size_t> flags;
+      multiLevelContext.getGridForLevel(level).getFlaggedCells(flags);
+      out.write(flags);
+      flags.clear();
+      multiLevelContext.getOutputGridForLevel(level).getFlaggedCells(flags);
+      out.write(flags);
+    }
+
+    out.write(modificationDefinitions.size());
+    for (const auto &definition : modificationDefinitions) {
+      out.write(definition.name);
+      out.write(definition.target);
+      out.write(definition.initialNumberSteps);
+      out.write(definition.precision);
+      out.write(definition.filterScale);
+      out.write(definition.flaggedCells);
+    }
+
+    for (size_t level = 0; level < nLevels; ++level) {
+      const auto &field = outputFields[0]->getFieldForLevel(level);
+      out.write(field.isFourier());
+      out.write(field.getDataVector());
+    }
+  }
+
+  /*! \brief Restore the state of the generator from a file written by checkpoint.
+   *
+   * This can be used at the start of a parameter file, in place of the commands that led up to the checkpoint,
+   * or later in a parameter file with the same grid layout to return to the checkpointed state. The file is
+   * mem-mapped, so that field data are copied directly from the page cache.
+   */
+  virtual void resume(std::string filename) {
+    if (outputFields.size() > 1 || outputFields[0]->getTransferType() != particle::species::whitenoise)
+      throw std::runtime_error("Cannot resume from a checkpoint after the power spectrum has been applied");
+
+    logging::entry() << "Resuming from checkpoint " << filename << endl;
+    io::checkpoint::Reader<GridDataType> in(filename);
+
+    cosmology = in.template read<cosmology::CosmologicalParameters<T>>();
+    std::string checkpointCambFilePath = in.readString();
+    T checkpointPowerLawAmplitude = in.template read<T>();
+    if (!checkpointCambFilePath.empty()) {
+      if (checkpointCambFilePath[0] != '/')
+        checkpointCambFilePath = tools::getAbsolutePath(
+          tools::getDirectoryName(filename) + "/" + checkpointCambFilePath);
+      if (spectrum == nullptr || checkpointCambFilePath != cambFilePath)
+        setCambDat(checkpointCambFilePath);
+    } else if (checkpointPowerLawAmplitude != 0) {
+      if (spectrum == nullptr || checkpointPowerLawAmplitude != powerLawAmplitude)
+        setPowerLawAmplitude(checkpointPowerLawAmplitude);
+    }
+
+    useBaryonTransferFunction = in.template read<bool>();
+    velOffset.x = in.template read<T>();
+    velOffset.y = in.template read<T>();
+    velOffset.z = in.template read<T>();
+    auto checkpointGadgetTypes = in.template readVector<unsigned int>();
+    flaggedParticlesHaveDifferentGadgetType = in.template read<bool>();
+    flaggedGadgetParticleType = in.template read<unsigned int>();
+    supersample = in.template read<int>();
+    supersampleGas = in.template read<int>();
+    subsample = in.template read<int>();
+    epsNorm = in.template read<T>();
+    exactPowerSpectrum = in.template read<bool>();
+    allowStrayParticles = in.template read<bool>();
+    centerOnTargetRegion = in.template read<bool>();
+    baryonsOnAllLevels = in.template read<bool>();
+    autopad = in.template read<size_t>();
+    x0 = in.template read<T>();
+    y0 = in.template read<T>();
+    z0 = in.template read<T>();
+    pvarValue = in.template read<T>();
+    variance_filterscale = in.template read<T>();
+    initial_number_steps = in.template read<int>();
+    precision = in.template read<T>();
+
+    size_t nLevels = in.template read<size_t>();
+    bool haveExistingLevels = multiLevelContext.getNumLevels() > 0;
+    if (haveExistingLevels && multiLevelContext.getNumLevels() != nLevels)
+      throw std::runtime_error("The grid layout in the checkpoint does not match the existing grids");
+    if (!haveExistingLevels)
+      multiLevelContext.allowStrays = allowStrayParticles;
+
+    for (size_t level = 0; level < nLevels; ++level) {
+      T gridSize = in.template read<T>();
+      size_t n = in.template read<size_t>();
+      Coordinate<T> offset;
+      offset.x = in.template read<T>();
+      offset.y = in.template read<T>();
+      offset.z = in.template read<T>();
+      if (haveExistingLevels) {
+        const grids::Grid<T> &grid = multiLevelContext.getGridForLevel(level);
+        if (grid.size != n || grid.thisGridSize != gridSize || !grid.offsetLower.almostEqual(offset))
+          throw std::runtime_error("The grid layout in the checkpoint does not match the existing grids");
+      } else {
+        addLevelToContext(gridSize, n, offset);
+      }
+    }
+    gadgetTypesForLevels = checkpointGadgetTypes;
+
+    zoomParticleArray = in.template readVectorOfVectors<size_t>();
+
+    std::vector<std::vector<size_t>> flags, outputFlags;
+    for (size_t level = 0; level < nLevels; ++level) {
+      flags.push_back(in.template readVector<size_t>());
+      outputFlags.push_back(in.template readVector<size_t>());
+    }
+
+    resumeModificationsAndFields(in);
+
+    for (size_t level = 0; level < nLevels; ++level) {
+      multiLevelContext.getOutputGridForLevel(level).unflagAllCells();
+      multiLevelContext.getGridForLevel(level).unflagAllCells();
+      multiLevelContext.getGridForLevel(level).flagCells(flags[level]);
+      multiLevelContext.getOutputGridForLevel(level).flagCells(outputFlags[level]);
+    }
+
+    updateParticleMapper();
+  }
+
+protected:
+
+  /*! \brief Restore the list of modifications and the white noise field from a checkpoint.
+   *
+   * These are the last items in the checkpoint, so that this can be skipped when only the grid layout is required.
+   */
+  virtual void resumeModificationsAndFields(io::checkpoint::Reader<GridDataType> &in) {
+    size_t nLevels = multiLevelContext.getNumLevels();
+
+    // Modifications pick up the region they act on from the cell flags at the time they are defined
+    clearModifications();
+    size_t nModifications = in.template read<size_t>();
+    for (size_t i = 0; i < nModifications; ++i) {
+      ModificationDefinition definition;
+      definition.name = in.readString();
+      definition.target = in.template read<T>();
+      definition.initialNumberSteps = in.template read<int>();
+      definition.precision = in.template read<T>();
+      definition.filterScale = in.template read<T>();
+      definition.flaggedCells = in.template readVectorOfVectors<size_t>();
+
+      for (size_t level = 0; level < nLevels; ++level) {
+        multiLevelContext.getGridForLevel(level).unflagAllCells();
+        if (level < definition.flaggedCells.size())
+          multiLevelContext.getGridForLevel(level).flagCells(definition.flaggedCells[level]);
+      }
+      modificationManager.addModificationToList(definition.name, "absolute", definition.target,
+                                                definition.initialNumberSteps, definition.precision,
+                                                definition.filterScale);
+      modificationDefinitions.push_back(std::move(definition));
+    }
+
+    for (size_t level = 0; level < nLevels; ++level) {
+      auto &field = outputFields[0]->getFieldForLevel(level);
+      field.setFourier(in.template read<bool>());
+      in.readArrayInto(field.getDataVector());
+    }
+
+    haveInitialisedRandomComponent = true;
+  }
+
+  /*! \brief Generate and write each realisation requested with setBatchSeeds.
+   *
+   * Each realisation is drawn when it is reached, so that only one white noise field (plus the reversed copy, if
+   * also_output_reversed was given) is held at a time. Commands following done act on the last realisation.
+   */
+  void writeBatch() {
+    if (haveInitialisedRandomComponent)
+      throw std::runtime_error("random_seeds cannot be used if the random field is needed before done "
+                               "(e.g. by calculate, reverse or splice)");
+    if (!randomFieldGenerator->isSeeded())
+      throw std::runtime_error("random_seeds must follow a random_seed command, which chooses how the field is drawn");
+
+    // Each realisation is a seed and whether to reverse its white noise
+    std::vector<std::pair<unsigned long, bool>> realisations;
+    for (auto seed : batchSeeds) {
+      realisations.emplace_back(seed, false);
+      if (alsoOutputReversed)
+        realisations.emplace_back(seed, true);
+    }
+
+    std::shared_ptr<fields::OutputField<GridDataType>> reversedWhiteNoise;
+
+    for (size_t i = 0; i < realisations.size(); ++i) {
+      unsigned long seed = realisations[i].first;
+      bool reversed = realisations[i].second;
+      logging::entry() << "Generating realisation " << i + 1 << " of " << realisations.size() << " (seed " << seed
+                       << (reversed ? ", reversed" : "") << ")" << endl;
+
+      // Start again from the white noise, discarding the fields and particle generators of the previous realisation
+      fields::OutputField<GridDataType> whiteNoise(multiLevelContext, particle::species::whitenoise);
+      if (reversed) {
+        whiteNoise.swap(*reversedWhiteNoise);
+        reversedWhiteNoise = nullptr;
+      } else {
+        fields::RandomFieldGenerator<GridDataType> generator(whiteNoise, *randomFieldGenerator);
+        generator.seed(seed);
+        generator.draw();
+        if (exactPowerSpectrum)
+          whiteNoise.enforceUnitVariance();
+      }
+
+      outputFields.resize(1);
+      outputFields[0]->swap(whiteNoise);
+      pParticleGenerator.clear();
+      multiLevelContext.setLevelsAreCombined(false);
+
+      // The reversed counterpart reuses this white noise
+      if (i + 1 < realisations.size() && realisations[i + 1].second) {
+        reversedWhiteNoise = std::make_shared<fields::OutputField<GridDataType>>(*outputFields[0]);
+        reversedWhiteNoise->reverse();
+      }
+
+      haveInitialisedRandomComponent = true;
+      if (modificationManager.hasModifications())
+        applyModifications();
+
+      outputSuffix = "_" + std::to_string(seed) + (reversed ? "_reversed" : "");
+      write();
+    }
+
+    outputSuffix.clear();
+  }
+
 };
 
 #endif
@@ -0,0 +1,235 @@
+#ifndef IC_CACHE_HPP
+#define IC_CACHE_HPP
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "src/io/checkpoint.hpp"
+#include "src/tools/logging.hpp"
+
+namespace io {
+  /*! \namespace io::cache
+      \brief Optional on-disk cache of expensive intermediate products, shared between runs.
+
+      Each entry is a field (or other array) stored under a hash of everything that determined its value, such as the
+      seed and grid sizes for a white noise draw. Runs of related parameter files that share a prefix of commands can
+      then reuse each other's work automatically. Entries are never invalidated, since a different input gives a
+      different hash; the directory can simply be deleted to reclaim space, and should be after upgrading the code.
+
+      The cache is disabled unless a directory has been set with setDirectory.
+  */
+  namespace cache {
+
+    constexpr uint64_t version = 1; //!< Mixed into every key; incremented if the way any cached product is computed changes
+
+    namespace detail {
+      inline std::string &directory() {
+        static std::string cacheDirectory;
+        return cacheDirectory;
+      }
+
+      inline uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+      }
+
+      inline uint64_t rotateLeft(uint64_t x, int bits) {
+        return (x << bits) | (x >> (64 - bits));
+      }
+    }
+
+    //! Use the given directory, which is created if necessary, to store cached products
+    inline void setDirectory(const std::string &path) {
+      if (::mkdir(path.c_str(), 0777) != 0 && errno != EEXIST)
+        throw std::runtime_error("Unable to create cache directory " + path + " (reason: " + ::strerror(errno) + ")");
+      detail::directory() = path;
+    }
+
+    //! True if a cache directory has been set
+    inline bool isEnabled() {
+      return !detail::directory().empty();
+    }
+
+    /*! \class Hasher
+        \brief Accumulates a 128-bit hash of the inputs to an expensive calculation, to use as its key in the cache.
+
+        This is not a cryptographic hash, but is more than adequate to distinguish the products of different runs.
+    */
+    class Hasher {
+    protected:
+      uint64_t h1, h2;
+
+      void addWord(uint64_t word) {
+        h1 = detail::rotateLeft(h1 ^ detail::mix(word), 27) * 5 + 0x52dce729;
+        h2 = detail::rotateLeft(h2 ^ detail::mix(word ^ 0x9e3779b97f4a7c15ULL), 31) * 5 + 0x38495ab5;
+      }
+
+      void addBytes(const char *bytes, size_t n) {
+        addWord(n);
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+          uint64_t word;
+          std::memcpy(&word, bytes + i, sizeof(uint64_t));
+          addWord(word);
+        }
+        if (i < n) {
+          uint64_t word = 0;
+          std::memcpy(&word, bytes + i, n - i);
+          addWord(word);
+        }
+      }
+
+    public:
+      //! Start a hash for the named kind of product
+      explicit Hasher(const std::string &productName) : h1(0x243f6a8885a308d3ULL), h2(0x13198a2e03707344ULL) {
+        addWord(version);
+        add(productName);
+      }
+
+      //! Add a plain-data item to the hash
+      template<typename ItemType>
+      Hasher &add(const ItemType &item) {
+        static_assert(std::is_trivially_copyable<ItemType>::value, "Only plain data can be hashed");
+        addBytes(reinterpret_cast<const char *>(&item), sizeof(ItemType));
+        return *this;
+      }
+
+      //! Add a string to the hash
+      Hasher &add(const std::string &item) {
+        addBytes(item.data(), item.size());
+        return *this;
+      }
+
+      //! Add another hash to this one
+      Hasher &add(const Hasher &other) {
+        addWord(other.h1);
+        addWord(other.h2);
+        return *this;
+      }
+
+      /*! \brief Add an array of plain data to the hash.
+       *
+       * Large arrays are split into fixed-size blocks which are hashed in parallel, so that the result does not
+       * depend on the number of threads.
+       */
+      template<typename ItemType>
+      Hasher &addArray(const ItemType *data, size_t n) {
+        static_assert(std::is_trivially_copyable<ItemType>::value, "Only plain data can be hashed");
+        constexpr size_t blockBytes = size_t(1) << 22;
+        const char *bytes = reinterpret_cast<const char *>(data);
+        size_t nBytes = n * sizeof(ItemType);
+        size_t nBlocks = (nBytes + blockBytes - 1) / blockBytes;
+
+        std::vector<Hasher> blockHashes(nBlocks, Hasher(0, 0));
+#pragma omp parallel for schedule(static)
+        for (size_t block = 0; block < nBlocks; ++block) {
+          size_t start = block * blockBytes;
+          blockHashes[block].addBytes(bytes + start, std::min(blockBytes, nBytes - start));
+        }
+
+        addWord(nBytes);
+        for (const auto &blockHash : blockHashes)
+          add(blockHash);
+        return *this;
+      }
+
+      //! Add the contents of a vector to the hash
+      template<typename ItemType, typename Allocator>
+      Hasher &add(const std::vector<ItemType, Allocator> &items) {
+        return addArray(items.data(), items.size());
+      }
+
+      //! Add the state and data of a field to the hash
+      template<typename FieldType>
+      Hasher &addField(const FieldType &field) {
+        add(field.isFourier());
+        return add(field.getDataVector());
+      }
+
+      //! Returns the hash as a string of hexadecimal digits
+      std::string getHexDigest() const {
+        char digest[33];
+        std::snprintf(digest, sizeof(digest), "%016llx%016llx", (unsigned long long) h1, (unsigned long long) h2);
+        return std::string(digest);
+      }
+
+    protected:
+      Hasher(uint64_t h1, uint64_t h2) : h1(h1), h2(h2) {}
+    };
+
+    namespace detail {
+      inline std::string getFilename(const Hasher &key) {
+        return directory() + "/" + key.getHexDigest() + ".gic";
+      }
+    }
+
+    /*! \brief Load the entry with the given key into data, which must already have the size of the cached array.
+     *
+     * \param extra - filled with any additional bytes stored with the entry
+     * \return true if the entry was found and loaded; false (leaving data unchanged) otherwise
+     */
+    template<typename GridDataType, typename DataType, typename Allocator>
+    bool load(const Hasher &key, std::vector<DataType, Allocator> &data, bool &fourier,
+              std::vector<char> *extra = nullptr) {
+      if (!isEnabled())
+        return false;
+      std::string filename = detail::getFilename(key);
+      if (::access(filename.c_str(), R_OK) != 0)
+        return false;
+
+      try {
+        io::checkpoint::Reader<GridDataType> in(filename);
+        if (in.readString() != key.getHexDigest())
+          return false;
+        bool fourierInFile = in.template read<bool>();
+        auto extraInFile = in.template readVector<char>();
+        in.readArrayInto(data);
+        fourier = fourierInFile;
+        if (extra != nullptr)
+          *extra = std::move(extraInFile);
+      } catch (std::runtime_error &e) {
+        logging::entry(logging::level::warning) << "WARNING: ignoring unreadable cache entry " << filename << " ("
+                                                << e.what() << ")" << std::endl;
+        return false;
+      }
+      return true;
+    }
+
+    /*! \brief Store data under the given key.
+     *
+     * The entry is written under a temporary name and then renamed, so that other runs sharing the cache never see
+     * a partially written entry.
+     */
+    template<typename GridDataType, typename DataType, typename Allocator>
+    void save(const Hasher &key, const std::vector<DataType, Allocator> &data, bool fourier,
+              const std::vector<char> &extra = {}) {
+      if (!isEnabled())
+        return;
+      std::string filename = detail::getFilename(key);
+      std::string temporaryFilename = filename + ".tmp" + std::to_string(::getpid());
+      {
+        io::checkpoint::Writer<GridDataType> out(temporaryFilename);
+        out.write(key.getHexDigest());
+        out.write(fourier);
+        out.write(extra);
+        out.write(data);
+      }
+      if (std::rename(temporaryFilename.c_str(), filename.c_str()) != 0)
+        std::remove(temporaryFilename.c_str());
+    }
+
+  }
+}
+
+#endif //IC_CACHE_HPP
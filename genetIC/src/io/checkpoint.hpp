@@ -0,0 +1,160 @@
+#ifndef IC_CHECKPOINT_HPP
+#define IC_CHECKPOINT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "src/tools/memmap.hpp"
+#include "src/tools/data_types/complex.hpp"
+
+namespace io {
+  /*! \namespace io::checkpoint
+      \brief Binary files holding the state of an ICGenerator part-way through a parameter file.
+
+      The file begins with a short header identifying the format and the floating point types used, followed by a
+      flat sequence of items in the order they are written by ICGenerator::checkpoint. Arrays are stored as a
+      64-bit length followed by the raw data, aligned to a cache line, so that on reading they can be copied directly
+      out of a mem-map of the file. The files are only intended to be read back by the same build of the code.
+  */
+  namespace checkpoint {
+
+    constexpr char magic[8] = {'g', 'e', 'n', 'e', 't', 'I', 'C', 'c'}; //!< Identifies checkpoint files
+    constexpr uint32_t version = 1; //!< Incremented whenever the layout of the file changes
+    constexpr size_t arrayAlignment = 64; //!< Alignment of array data within the file, in bytes
+
+    /*! \class Writer
+        \brief Writes a checkpoint file, item by item.
+    */
+    template<typename GridDataType>
+    class Writer {
+    protected:
+      tools::MemMapFileWriter file;
+
+    public:
+      //! Create the named file and write the header
+      explicit Writer(const std::string &filename) : file(filename) {
+        for (char c : magic)
+          file.write(c);
+        file.write(version);
+        file.write(uint32_t(sizeof(GridDataType)));
+        file.write(uint32_t(sizeof(tools::datatypes::strip_complex<GridDataType>)));
+      }
+
+      //! Write a single plain-data item
+      template<typename ItemType>
+      void write(const ItemType &item) {
+        static_assert(std::is_trivially_copyable<ItemType>::value, "Only plain data can be written to a checkpoint");
+        file.write(item);
+      }
+
+      //! Write a string, preceded by its length
+      void write(const std::string &item) {
+        write(uint64_t(item.size()));
+        for (char c : item)
+          file.write(c);
+      }
+
+      //! Write an array of plain data, preceded by its length, copying it into the file in parallel
+      template<typename ItemType>
+      void writeArray(const ItemType *data, size_t n) {
+        static_assert(std::is_trivially_copyable<ItemType>::value, "Only plain data can be written to a checkpoint");
+        write(uint64_t(n));
+        file.align(arrayAlignment);
+        if (n == 0)
+          return;
+        auto region = file.getMemMap<ItemType>(n);
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i)
+          region[i] = data[i];
+      }
+
+      //! Write the contents of a vector as an array
+      template<typename ItemType, typename Allocator>
+      void write(const std::vector<ItemType, Allocator> &items) {
+        writeArray(items.data(), items.size());
+      }
+
+      //! Write a vector of vectors, e.g. one list of cells for each level
+      template<typename ItemType>
+      void write(const std::vector<std::vector<ItemType>> &items) {
+        write(uint64_t(items.size()));
+        for (const auto &item : items)
+          write(item);
+      }
+    };
+
+    /*! \class Reader
+        \brief Reads a checkpoint file through a mem-map, in the same order as it was written by Writer.
+    */
+    template<typename GridDataType>
+    class Reader {
+    protected:
+      tools::MemMapFileReader file;
+      std::string filename;
+
+    public:
+      //! Open the named file and check its header is compatible with this build of the code
+      explicit Reader(const std::string &filename) : file(filename), filename(filename) {
+        char fileMagic[sizeof(magic)];
+        for (char &c : fileMagic)
+          c = file.read<char>();
+        if (std::memcmp(fileMagic, magic, sizeof(magic)) != 0)
+          throw std::runtime_error(filename + " is not a genetIC checkpoint file");
+        if (file.read<uint32_t>() != version)
+          throw std::runtime_error(filename + " was written by an incompatible version of genetIC");
+        if (file.read<uint32_t>() != sizeof(GridDataType) ||
+            file.read<uint32_t>() != sizeof(tools::datatypes::strip_complex<GridDataType>))
+          throw std::runtime_error(filename + " was written by a build of genetIC with a different floating point precision");
+      }
+
+      //! Read a single plain-data item
+      template<typename ItemType>
+      ItemType read() {
+        static_assert(std::is_trivially_copyable<ItemType>::value, "Only plain data can be read from a checkpoint");
+        return file.read<ItemType>();
+      }
+
+      //! Read a string
+      std::string readString() {
+        size_t n = read<uint64_t>();
+        const char *data = file.getPointer<char>(n);
+        return std::string(data, n);
+      }
+
+      //! Read an array into a vector, which must already have the expected size, copying it out in parallel
+      template<typename ItemType, typename Allocator>
+      void readArrayInto(std::vector<ItemType, Allocator> &target) {
+        size_t n = read<uint64_t>();
+        if (n != target.size())
+          throw std::runtime_error("Data in checkpoint file " + filename + " does not match the expected size");
+        file.align(arrayAlignment);
+        const ItemType *data = file.getPointer<ItemType>(n);
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i)
+          target[i] = data[i];
+      }
+
+      //! Read an array of any length into a new vector
+      template<typename ItemType>
+      std::vector<ItemType> readVector() {
+        size_t n = read<uint64_t>();
+        file.align(arrayAlignment);
+        const ItemType *data = file.getPointer<ItemType>(n);
+        return std::vector<ItemType>(data, data + n);
+      }
+
+      //! Read a vector of vectors, as written by Writer
+      template<typename ItemType>
+      std::vector<std::vector<ItemType>> readVectorOfVectors() {
+        std::vector<std::vector<ItemType>> items(read<uint64_t>());
+        for (auto &item : items)
+          item = readVector<ItemType>();
+        return items;
+      }
+    };
+  }
+}
+
+#endif //IC_CHECKPOINT_HPP
@@ -2,6 +2,7 @@
 #define IC_GADGET_HPP
 
 #include "src/tools/memmap.hpp"
+#include "src/tools/profiling.hpp"
 #include "src/tools/data_types/float_types.hpp"
 #include "src/io.hpp"
 #include "src/simulation/particles/species.hpp"
@@ -260,9 +261,12 @@ namespace io {
 
       //! \brief Save a gadget block such as the mass or position arrays.
       //! Takes a lambda (or other function) which, given a mapper iterator, returns the data to be written for that
-      //! particle. The writing proceeds in parallel using a memmap.
+      //! particle. The writing proceeds in parallel using a memmap. The block name is used only for profiling.
       template<typename WriteType>
-      void saveGadgetBlock(std::function<WriteType(const particle::mapper::MapperIterator<GridDataType> &)> getData) {
+      void saveGadgetBlock(const std::string &blockName,
+                           std::function<WriteType(const particle::mapper::MapperIterator<GridDataType> &)> getData) {
+
+        tools::profiling::ScopedTimer timer("write_" + blockName);
 
         size_t current_n = 0;
 
@@ -378,28 +382,28 @@ namespace io {
         writeHeader();
 
         // positions
-        saveGadgetBlock<Coordinate<OutputFloatType>>(
+        saveGadgetBlock<Coordinate<OutputFloatType>>("positions",
           [](auto &localIterator) {
             auto particle = localIterator.getParticle();
             return Coordinate<OutputFloatType>(particle.pos);
           });
 
         // velocities
-        saveGadgetBlock<Coordinate<OutputFloatType>>(
+        saveGadgetBlock<Coordinate<OutputFloatType>>("velocities",
           [](auto &localIterator) {
             auto particle = localIterator.getParticle();
             return Coordinate<OutputFloatType>(particle.vel);
           });
 
         // IDs
-        saveGadgetBlock<long>(
+        saveGadgetBlock<long>("ids",
           [](auto &localIterator) {
             return localIterator.getIndex();
           });
 
 
         if (variableMass) {
-          saveGadgetBlock<OutputFloatType>(
+          saveGadgetBlock<OutputFloatType>("masses",
             [](auto &localIterator) {
               return localIterator.getMass();
             });
@@ -2,6 +2,7 @@
 #include <src/simulation/particles/multilevelgenerator.hpp>
 #include <src/simulation/multilevelgrid/mask.hpp>
 #include "src/tools/memmap.hpp"
+#include "src/tools/profiling.hpp"
 #include <memory>
 #include <vector>
 #include <algorithm>
@@ -114,6 +115,8 @@ namespace io {
       */
       void writeGrid(const grids::Grid<T> &targetGrid, size_t level) {
 
+        tools::profiling::ScopedTimer timer("write_level_" + std::to_string(level));
+
         auto evaluator_dm = generators[particle::dm]->makeParticleEvaluatorForGrid(targetGrid);
         auto overdensityFieldEvaluator = generators[particle::baryon]->makeOverdensityEvaluatorForGrid(targetGrid);
 
@@ -0,0 +1,276 @@
+#ifndef IC_IDS_HPP
+#define IC_IDS_HPP
+
+#include <sys/stat.h>
+#include <omp.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "src/io/numpy.hpp"
+#include "src/tools/memmap.hpp"
+
+namespace io {
+  /*! \namespace io::ids
+      \brief Reading and writing lists of particle IDs, as used by id_file, merge_id_file and dump_id_file.
+
+      The format is chosen by the file extension:
+        - .npy files hold a numpy array of integers (signed or unsigned, 4 or 8 bytes per ID);
+        - .bin files hold raw native-endian unsigned 64-bit integers with no header;
+        - anything else is text, with IDs separated by whitespace.
+
+      Binary files are mem-mapped and converted in parallel. Text files are also mem-mapped, then split into one
+      block per thread at whitespace boundaries and parsed in parallel.
+  */
+  namespace ids {
+
+    enum class Format {
+      text, binary, numpy
+    };
+
+    //! Returns the format of an ID file implied by its extension
+    inline Format getFormat(const std::string &filename) {
+      auto hasExtension = [&filename](const std::string &extension) {
+        return filename.size() >= extension.size() &&
+               filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+      };
+      if (hasExtension(".npy"))
+        return Format::numpy;
+      else if (hasExtension(".bin"))
+        return Format::binary;
+      else
+        return Format::text;
+    }
+
+    namespace detail {
+      inline bool isWhitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+      }
+
+      //! Parses whitespace-separated non-negative integers in [begin, end), returning false on a malformed ID
+      inline bool parseText(const char *begin, const char *end, std::vector<size_t> &ids) {
+        const char *p = begin;
+        while (true) {
+          while (p < end && isWhitespace(*p))
+            ++p;
+          if (p == end)
+            return true;
+
+          const char *tokenStart = p;
+          size_t value = 0;
+          while (p < end && *p >= '0' && *p <= '9') {
+            size_t digit = size_t(*p - '0');
+            if (value > (std::numeric_limits<size_t>::max() - digit) / 10)
+              return false;
+            value = value * 10 + digit;
+            ++p;
+          }
+          if (p == tokenStart || (p < end && !isWhitespace(*p)))
+            return false;
+          ids.push_back(value);
+        }
+      }
+
+      //! Converts n IDs of the given type to size_t in parallel, rejecting negative values
+      template<typename SourceType>
+      void convert(const char *data, size_t n, std::vector<size_t> &ids, const std::string &filename) {
+        const SourceType *source = reinterpret_cast<const SourceType *>(data);
+        ids.resize(n);
+        bool negative = false;
+#pragma omp parallel for reduction(||:negative)
+        for (size_t i = 0; i < n; ++i) {
+          if (std::is_signed<SourceType>::value && source[i] < SourceType(0))
+            negative = true;
+          ids[i] = size_t(source[i]);
+        }
+        if (negative)
+          throw std::runtime_error("Negative particle ID in " + filename);
+      }
+
+      //! Returns the text between the parentheses or quotes following the given key in a numpy header
+      inline std::string getNumpyHeaderValue(const std::string &header, const std::string &key,
+                                             char open, char close, const std::string &filename) {
+        size_t keyPos = header.find("'" + key + "'");
+        size_t start = keyPos == std::string::npos ? std::string::npos : header.find(open, keyPos + key.size() + 2);
+        size_t end = start == std::string::npos ? std::string::npos : header.find(close, start + 1);
+        if (end == std::string::npos)
+          throw std::runtime_error("Could not find '" + key + "' in the header of " + filename);
+        return header.substr(start + 1, end - start - 1);
+      }
+
+      inline void loadText(const std::string &filename, std::vector<size_t> &ids) {
+        tools::MemMapFileReader reader(filename);
+        size_t size = reader.getRemainingBytes();
+        const char *data = reader.getPointer<char>(size);
+
+        // Split into one block per thread, moving each boundary forward to whitespace so that no ID is divided
+        size_t nBlocks = size < 1 << 20 ? 1 : size_t(omp_get_max_threads());
+        std::vector<size_t> blockStart(nBlocks + 1);
+        blockStart[0] = 0;
+        blockStart[nBlocks] = size;
+        for (size_t i = 1; i < nBlocks; ++i) {
+          blockStart[i] = std::max(size * i / nBlocks, blockStart[i - 1]);
+          while (blockStart[i] < size && !isWhitespace(data[blockStart[i]]))
+            ++blockStart[i];
+        }
+
+        std::vector<std::vector<size_t>> blockIds(nBlocks);
+        std::vector<char> blockOk(nBlocks);
+#pragma omp parallel for schedule(static, 1)
+        for (size_t i = 0; i < nBlocks; ++i)
+          blockOk[i] = parseText(data + blockStart[i], data + blockStart[i + 1], blockIds[i]);
+
+        for (size_t i = 0; i < nBlocks; ++i) {
+          if (!blockOk[i])
+            throw std::runtime_error("Error reading file " + filename);
+        }
+
+        std::vector<size_t> blockOffset(nBlocks + 1, 0);
+        for (size_t i = 0; i < nBlocks; ++i)
+          blockOffset[i + 1] = blockOffset[i] + blockIds[i].size();
+
+        ids.resize(blockOffset[nBlocks]);
+#pragma omp parallel for schedule(static, 1)
+        for (size_t i = 0; i < nBlocks; ++i)
+          std::copy(blockIds[i].begin(), blockIds[i].end(), ids.begin() + blockOffset[i]);
+      }
+
+      inline void loadBinary(const std::string &filename, std::vector<size_t> &ids) {
+        tools::MemMapFileReader reader(filename);
+        size_t size = reader.getRemainingBytes();
+        if (size % sizeof(uint64_t) != 0)
+          throw std::runtime_error("Binary ID file " + filename + " is not a whole number of 64-bit integers");
+        size_t n = size / sizeof(uint64_t);
+        convert<uint64_t>(reader.getPointer<char>(size), n, ids, filename);
+      }
+
+      inline void loadNumpy(const std::string &filename, std::vector<size_t> &ids) {
+        tools::MemMapFileReader reader(filename);
+
+        std::string magic(reader.getPointer<char>(6), 6);
+        if (magic != "\x93NUMPY")
+          throw std::runtime_error(filename + " is not a valid numpy file");
+        auto majorVersion = reader.read<uint8_t>();
+        reader.read<uint8_t>();
+        size_t headerLength = majorVersion == 1 ? reader.read<uint16_t>() : reader.read<uint32_t>();
+        std::string header(reader.getPointer<char>(headerLength), headerLength);
+
+        std::string descriptor = getNumpyHeaderValue(header, "descr", '\'', '\'', filename);
+        if (descriptor.size() != 3)
+          throw std::runtime_error("Unsupported data type " + descriptor + " in " + filename);
+#ifdef AOBA_NUMPY_LITTLE_ENDIAN
+        bool nativeOrder = descriptor[0] == '<' || descriptor[0] == '|' || descriptor[0] == '=';
+#else
+        bool nativeOrder = descriptor[0] == '>' || descriptor[0] == '|' || descriptor[0] == '=';
+#endif
+        if (!nativeOrder)
+          throw std::runtime_error("The numpy file " + filename
+                                   + " has a different endian convention, which is not supported.");
+
+        // The IDs are read in memory order whatever the shape, so only the total number matters
+        std::string shape = getNumpyHeaderValue(header, "shape", '(', ')', filename);
+        size_t n = 1;
+        std::istringstream shapeStream(shape);
+        std::string dimension;
+        while (std::getline(shapeStream, dimension, ','))
+          if (dimension.find_first_not_of(' ') != std::string::npos)
+            n *= std::stoul(dimension);
+
+        std::string type = descriptor.substr(1);
+        if (type == "u8")
+          convert<uint64_t>(reader.getPointer<char>(n * 8), n, ids, filename);
+        else if (type == "i8")
+          convert<int64_t>(reader.getPointer<char>(n * 8), n, ids, filename);
+        else if (type == "u4")
+          convert<uint32_t>(reader.getPointer<char>(n * 4), n, ids, filename);
+        else if (type == "i4")
+          convert<int32_t>(reader.getPointer<char>(n * 4), n, ids, filename);
+        else
+          throw std::runtime_error("Unsupported data type " + descriptor + " in " + filename
+                                   + "; particle IDs must be 4 or 8 byte integers");
+      }
+
+      inline void saveText(const std::string &filename, const std::vector<size_t> &ids) {
+        std::ofstream f(filename);
+        if (!f.is_open())
+          throw std::runtime_error("Can't open file " + filename);
+
+        // Format one block per thread, then write the blocks in order
+        size_t nBlocks = ids.size() < 1 << 16 ? 1 : size_t(omp_get_max_threads());
+        std::vector<std::string> blockText(nBlocks);
+#pragma omp parallel for schedule(static, 1)
+        for (size_t i = 0; i < nBlocks; ++i) {
+          for (size_t j = ids.size() * i / nBlocks; j < ids.size() * (i + 1) / nBlocks; ++j) {
+            blockText[i] += std::to_string(ids[j]);
+            blockText[i] += '\n';
+          }
+        }
+
+        for (const auto &text : blockText)
+          f << text;
+      }
+
+      inline void saveBinary(const std::string &filename, const std::vector<size_t> &ids) {
+        static_assert(sizeof(size_t) == sizeof(uint64_t), "Binary ID files require 64-bit particle IDs");
+        std::ofstream f(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!f.is_open())
+          throw std::runtime_error("Can't open file " + filename);
+        f.write(reinterpret_cast<const char *>(ids.data()), ids.size() * sizeof(size_t));
+      }
+
+      inline void saveNumpy(const std::string &filename, const std::vector<size_t> &ids) {
+        static_assert(sizeof(size_t) == sizeof(uint64_t), "Binary ID files require 64-bit particle IDs");
+        if (ids.size() > size_t(INT_MAX))
+          throw std::runtime_error("Too many particle IDs to write to " + filename + "; use a .bin file instead");
+        const uint64_t *data = reinterpret_cast<const uint64_t *>(ids.data());
+        numpy::SaveArrayAsNumpy(filename, int(ids.size()), data);
+      }
+    }
+
+    //! Read the particle IDs in the named file, in the format given by its extension, into ids
+    inline void load(const std::string &filename, std::vector<size_t> &ids) {
+      ids.clear();
+
+      struct stat st;
+      if (::stat(filename.c_str(), &st) != 0)
+        throw std::runtime_error("File " + filename + " not found");
+      if (st.st_size == 0)
+        return;
+
+      switch (getFormat(filename)) {
+        case Format::numpy:
+          detail::loadNumpy(filename, ids);
+          break;
+        case Format::binary:
+          detail::loadBinary(filename, ids);
+          break;
+        case Format::text:
+          detail::loadText(filename, ids);
+          break;
+      }
+    }
+
+    //! Write the particle IDs to the named file, in the format given by its extension
+    inline void save(const std::string &filename, const std::vector<size_t> &ids) {
+      switch (getFormat(filename)) {
+        case Format::numpy:
+          detail::saveNumpy(filename, ids);
+          break;
+        case Format::binary:
+          detail::saveBinary(filename, ids);
+          break;
+        case Format::text:
+          detail::saveText(filename, ids);
+          break;
+      }
+    }
+
+  }
+}
+
+#endif //IC_IDS_HPP
@@ -106,6 +106,14 @@ namespace io {
         static const char value = 'i';
       };
       template<>
+      struct DescriptorDataType<unsigned long> {
+        static const char value = 'u';
+      };
+      template<>
+      struct DescriptorDataType<unsigned long long> {
+        static const char value = 'u';
+      };
+      template<>
       struct DescriptorDataType<std::complex<float> > {
         static const char value = 'c';
       };
@@ -238,10 +246,10 @@ namespace io {
       SaveArrayAsNumpy(filename, false, 4, dim, data);
     }
 
-    template<typename Scalar>
+    template<typename Scalar, typename Allocator>
     void LoadArrayFromNumpy(
         const std::string &filename, std::vector<int> &shape,
-        std::vector<Scalar> &data) {
+        std::vector<Scalar, Allocator> &data) {
       std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
       if (!stream) {
         throw std::runtime_error("io error: failed to open a file.");
@@ -323,25 +331,25 @@ namespace io {
       stream.read(reinterpret_cast<char *>(&data[0]), word_size * total);
     }
 
-    template<typename Scalar>
+    template<typename Scalar, typename Allocator>
     void LoadArrayFromNumpy(
-        const std::string &filename, std::vector<Scalar> &data) {
+        const std::string &filename, std::vector<Scalar, Allocator> &data) {
       std::vector<int> tmp_dim;
       LoadArrayFromNumpy(filename, tmp_dim, data);
     }
 
-    template<typename Scalar>
+    template<typename Scalar, typename Allocator>
     void LoadArrayFromNumpy(
-        const std::string &filename, int shape[], std::vector<Scalar> &data) {
+        const std::string &filename, int shape[], std::vector<Scalar, Allocator> &data) {
       std::vector<int> tmp_dim;
       LoadArrayFromNumpy(filename, tmp_dim, data);
       for (size_t i = 0; i < tmp_dim.size(); ++i) shape[i] = tmp_dim[i];
     }
 
-    template<typename Scalar>
+    template<typename Scalar, typename Allocator>
     void LoadArrayFromNumpy(
         const std::string &filename,
-        int &x0, std::vector<Scalar> &data) {
+        int &x0, std::vector<Scalar, Allocator> &data) {
       std::vector<int> tmp_dim;
       LoadArrayFromNumpy(filename, tmp_dim, data);
       if (tmp_dim.size() != 1) {
@@ -350,10 +358,10 @@ namespace io {
       x0 = tmp_dim[0];
     }
 
-    template<typename Scalar>
+    template<typename Scalar, typename Allocator>
     void LoadArrayFromNumpy(
         const std::string &filename,
-        int &x0, int &x1, std::vector<Scalar> &data) {
+        int &x0, int &x1, std::vector<Scalar, Allocator> &data) {
       std::vector<int> tmp_dim;
       LoadArrayFromNumpy(filename, tmp_dim, data);
       if (tmp_dim.size() != 2) {
@@ -363,10 +371,10 @@ namespace io {
       x1 = tmp_dim[1];
     }
 
-    template<typename Scalar>
+    template<typename Scalar, typename Allocator>
     void LoadArrayFromNumpy(
         const std::string &filename,
-        int &x0, int &x1, int &x2, std::vector<Scalar> &data) {
+        int &x0, int &x1, int &x2, std::vector<Scalar, Allocator> &data) {
       std::vector<int> tmp_dim;
       LoadArrayFromNumpy(filename, tmp_dim, data);
       if (tmp_dim.size() != 3) {
@@ -377,10 +385,10 @@ namespace io {
       x2 = tmp_dim[2];
     }
 
-    template<typename Scalar>
+    template<typename Scalar, typename Allocator>
     void LoadArrayFromNumpy(
         const std::string &filename,
-        int &x0, int &x1, int &x2, int &x3, std::vector<Scalar> &data) {
+        int &x0, int &x1, int &x2, int &x3, std::vector<Scalar, Allocator> &data) {
       std::vector<int> tmp_dim;
       LoadArrayFromNumpy(filename, tmp_dim, data);
       if (tmp_dim.size() != 4) {
@@ -2,6 +2,7 @@
 #define IC_TIPSY_HPP
 
 #include <src/tools/memmap.hpp>
+#include <src/tools/profiling.hpp>
 #include "src/io.hpp"
 #include "src/simulation/particles/mapper/mapper.hpp"
 #include "src/simulation/particles/species.hpp"
@@ -96,6 +97,7 @@ namespace io {
       tools::MemMapFileWriter writer; //!< Writer used to process output file using memory maps.
       std::ofstream photogenic_file; //!< Photogenic output file.
       size_t iord; //!< Cumulative index offset.
+      size_t photogenicStride; //!< One in this many highest-resolution particles is photogenic (the number of threads)
       double pos_factor; //!< Factor to multiply internal position offset by to get tipsy units.
       double vel_factor; //!< Factor to multiply velocity offset by (especially as internal gadget-units velocities are used).
       double mass_factor;//!< Factor to multiply masses by to get tipsy units.
@@ -114,6 +116,11 @@ namespace io {
 
         auto p = writer.getMemMap<ParticleType>(n);
 
+        // Photogenic particles are chosen by index, so that they are spread evenly however the particles are
+        // divided between threads. Each thread marks its own, and they are written in order afterwards.
+        size_t firstPhotogenic = (photogenicStride - iord % photogenicStride) % photogenicStride;
+        std::vector<char> isPhotogenic(n / photogenicStride + 1, 0);
+
 
         begin.parallelIterate([&](size_t i, const particle::mapper::MapperIterator<GridDataType> &localIterator) {
           TipsyParticle::initialise(p[i], cosmology);
@@ -128,15 +135,16 @@ namespace io {
           p[i].vz = thisParticle.vel.z * vel_factor;
           p[i].mass = thisParticle.mass * mass_factor;
 
-#ifdef _OPENMP
-          if (thisParticle.mass == min_mass && omp_get_thread_num() == 0)
-#else
-            if(thisParticle.mass==min_mass)
-#endif
-            photogenic_file << iord + i << std::endl;
+          if (thisParticle.mass == min_mass && (iord + i) % photogenicStride == 0)
+            isPhotogenic[i / photogenicStride] = 1;
 
         }, n);
 
+        for (size_t i = firstPhotogenic; i < n; i += photogenicStride) {
+          if (isPhotogenic[i / photogenicStride])
+            photogenic_file << iord + i << std::endl;
+        }
+
         iord += n;
 
 
@@ -196,6 +204,11 @@ namespace io {
                   std::shared_ptr<particle::mapper::ParticleMapper<GridDataType>> pMapper,
                   const cosmology::CosmologicalParameters<FloatType> &cosmology) : generators(_generators),
                                                                                    iord(0),
+#ifdef _OPENMP
+                                                                                   photogenicStride(size_t(omp_get_max_threads())),
+#else
+                                                                                   photogenicStride(1),
+#endif
                                                                                    boxLength(boxLength),
                                                                                    pMapper(pMapper),
                                                                                    cosmology(cosmology) {
@@ -262,10 +275,16 @@ namespace io {
 
         writer.write<>(header);
 
-        saveTipsyParticles<TipsyParticle::gas>(pMapper->beginGas(*generators.at(particle::species::baryon)),
-                                               pMapper->endGas(*generators.at(particle::species::baryon)));
-        saveTipsyParticles<TipsyParticle::dark>(pMapper->beginDm(*generators.at(particle::species::dm)),
-                                                pMapper->endDm(*generators.at(particle::species::dm)));
+        {
+          tools::profiling::ScopedTimer timer("write_gas");
+          saveTipsyParticles<TipsyParticle::gas>(pMapper->beginGas(*generators.at(particle::species::baryon)),
+                                                 pMapper->endGas(*generators.at(particle::species::baryon)));
+        }
+        {
+          tools::profiling::ScopedTimer timer("write_dark");
+          saveTipsyParticles<TipsyParticle::dark>(pMapper->beginDm(*generators.at(particle::species::dm)),
+                                                  pMapper->endDm(*generators.at(particle::species::dm)));
+        }
 
       }
     };
@@ -6,6 +6,7 @@
 
 #include "tools/parser.hpp"
 #include "tools/logging.hpp"
+#include "tools/profiling.hpp"
 #include "ic.hpp"
 #include "dummyic.hpp"
 
@@ -52,15 +53,21 @@ void setup_parser(tools::ClassDispatch<ICf, void> &dispatch) {
   dispatch.add_class_route("random_seed_serial", static_cast<void (ICf::*)(int)>(&ICf::setSeedFourier));
   dispatch.add_class_route("random_seed_real_space", static_cast<void (ICf::*)(int)>(&ICf::setSeed));
 
+  // Generate several realisations in one run
+  dispatch.add_class_route("random_seeds", &ICf::setBatchSeeds);
+  dispatch.add_class_route("also_output_reversed", &ICf::setAlsoOutputReversed);
+
   // Optional computational properties
   dispatch.add_deprecated_class_route("exact_power_spectrum_enforcement", "fix_power", &ICf::setExactPowerSpectrumEnforcement);
   dispatch.add_class_route("fix_power", &ICf::setExactPowerSpectrumEnforcement);
+  dispatch.add_class_route("paired_output", &ICf::setPairedOutput);
 
   dispatch.add_class_route("strays_on", &ICf::setStraysOn);
   dispatch.add_class_route("supersample", &ICf::setSupersample);
   dispatch.add_class_route("supersample_gas", &ICf::setSupersampleGas);
   dispatch.add_class_route("subsample", &ICf::setSubsample);
   dispatch.add_class_route("eps_norm", &ICf::setEpsNorm);
+  dispatch.add_class_route("lean_zeldovich", &ICf::setLeanZeldovich);
 
   // Grafic options
   dispatch.add_class_route("pvar", &ICf::setpvarValue);
@@ -84,7 +91,9 @@ void setup_parser(tools::ClassDispatch<ICf, void> &dispatch) {
   // Set output paths and format
   dispatch.add_class_route("outdir", &ICf::setOutDir);
   dispatch.add_class_route("outname", &ICf::setOutName);
-  dispatch.add_class_route("outformat", &ICf::setOutputFormat);
+  dispatch.add_class_route("outformat", &ICf::setOutputFormats);
+  dispatch.add_class_route("storage_directory", &ICf::setStorageDirectory);
+  dispatch.add_class_route("cache_directory", &ICf::setCacheDirectory);
 
   // Define grid structure - OLD NAMES
   dispatch.add_deprecated_class_route("basegrid", "base_grid", &ICf::initBaseGrid);
@@ -137,6 +146,10 @@ void setup_parser(tools::ClassDispatch<ICf, void> &dispatch) {
   dispatch.add_class_route("reverse_small_k", static_cast<void (ICf::*)(FloatType)>(&ICf::reverseSmallK));
   dispatch.add_class_route("splice", &ICf::splice);
 
+  // Save and restore the state part-way through a parameter file
+  dispatch.add_class_route("checkpoint", &ICf::checkpoint);
+  dispatch.add_class_route("resume", &ICf::resume);
+
   // Write objects to files
   // dispatch.add_class_route("dump_grid", &ICf::dumpGrid);
   dispatch.add_class_route("dump_grid", static_cast<void (ICf::*)(size_t)>(&ICf::dumpGrid));
@@ -147,6 +160,9 @@ void setup_parser(tools::ClassDispatch<ICf, void> &dispatch) {
                            static_cast<void (ICf::*)(size_t, particle::species)>(&ICf::dumpGridFourier));
   dispatch.add_class_route("dump_ps", static_cast<void (ICf::*)(size_t)>(&ICf::dumpPS));
   dispatch.add_class_route("dump_ps_field", static_cast<void (ICf::*)(size_t, particle::species)>(&ICf::dumpPS));
+  dispatch.add_class_route("dump_cross_ps_species", &ICf::dumpCrossPSSpecies);
+  dispatch.add_class_route("dump_cross_ps_levels", &ICf::dumpCrossPSLevels);
+  dispatch.add_class_route("ps_binning", &ICf::setPowerSpectrumBinning);
   dispatch.add_class_route("dump_tipsy", static_cast<void (ICf::*)(std::string)>(&ICf::saveTipsyArray));
   dispatch.add_class_route("dump_tipsy_field", static_cast<void (ICf::*)(std::string, size_t)>(&ICf::saveTipsyArray));
   dispatch.add_class_route("dump_mask", &ICf::dumpMask);
@@ -242,5 +258,8 @@ int main(int argc, char *argv[]) {
   // Process commands
   dispatch.run_loop(inf, outf);
 
+  // Timings and memory use of each command, alongside the record of the parameters used
+  tools::profiling::writeReport("IC_output.profile");
+
   return 0;
 }
@@ -3,12 +3,16 @@
 
 #include <memory>
 #include <vector>
+#include <array>
+#include <typeinfo>
 #include <cassert>
 #include <src/simulation/filters/filter.hpp>
 #include <src/tools/numerics/fourier.hpp>
 #include "src/io/numpy.hpp"
 #include "src/simulation/grid/grid.hpp"
 #include "src/tools/numerics/tricubic.hpp"
+#include "src/tools/fieldstorage.hpp"
+#include "src/tools/profiling.hpp"
 #include "boost/compute/detail/lru_cache.hpp"
 
 /*!
@@ -109,9 +113,11 @@ namespace fields {
   public:
     using TGrid = const grids::Grid<CoordinateType>;
     using TPtrGrid = std::shared_ptr<TGrid>;
-    using TData = std::vector<DataType>;
+    using TData = std::vector<DataType, tools::storage::FieldAllocator<DataType>>;
     using value_type = DataType;
     using ComplexType = tools::datatypes::ensure_complex<DataType>;
+    //! Type in which interpolation is carried out; at least the precision of the coordinates, even for compact storage
+    using InterpolationType = decltype(DataType() * CoordinateType());
 
     using FourierManager = tools::numerics::fourier::FieldFourierManager<DataType>;
     enum {
@@ -144,8 +150,8 @@ namespace fields {
     //! Copy constructor
     Field(const Field<DataType, CoordinateType> &copy)
       : std::enable_shared_from_this<Field<DataType, CoordinateType>>(),
-        pGrid(copy.pGrid), data(copy.data),
-        fourier(copy.fourier) {
+        pGrid(copy.pGrid), fourier(copy.fourier) {
+      tools::storage::copyInParallel(copy.data, data);
       fourierManager = std::make_shared<FourierManager>(*this);
       assert(data.size() == fourierManager->getRequiredDataSize());
     }
@@ -163,7 +169,8 @@ namespace fields {
 
     //! Construct a field on the specified grid by copying the given data
     Field(TGrid &grid, const TData &dataVector, bool fourier = true) : pGrid(grid.shared_from_this()),
-                                                                       data(dataVector), fourier(fourier) {
+                                                                       fourier(fourier) {
+      tools::storage::copyInParallel(dataVector, data);
 
       fourierManager = std::make_shared<FourierManager>(*this);
       assert(data.size() == fourierManager->getRequiredDataSize());
@@ -171,10 +178,15 @@ namespace fields {
     }
 
     //! Construct a zero-filled field on the specified grid
+    /*!
+     * The storage is allocated uninitialised and zeroed in parallel, so that its pages are first touched by the
+     * threads that will later operate on them.
+     */
     Field(TGrid &grid, bool fourier = true) : pGrid(grid.shared_from_this()),
                                               fourierManager(std::make_shared<FourierManager>(*this)),
-                                              data(fourierManager->getRequiredDataSize(), 0),
+                                              data(fourierManager->getRequiredDataSize()),
                                               fourier(fourier) {
+      tools::storage::fillInParallel(data, DataType(0));
     }
 
   public:
@@ -195,15 +207,20 @@ namespace fields {
     }
 
     //! Returns a reference to the data vector storing the field.
-    operator std::vector<DataType> &() {
+    operator TData &() {
       return getDataVector();
     }
 
     //! Returns a constant reference to the data vector storing the field.
-    operator const std::vector<DataType> &() const {
+    operator const TData &() const {
       return getDataVector();
     }
 
+    //! Hint that this field will not be used for a while. If it is file-backed, its pages may be written out to disk.
+    void adviseRarelyUsed() const {
+      tools::storage::adviseRarelyUsed(data.data(), data.size() * sizeof(DataType));
+    }
+
     //! Evaluates the field at the grid point nearest to the supplied coordinate.
     DataType evaluateNearest(const Coordinate<CoordinateType> &location) const {
       auto offsetLower = pGrid->offsetLower;
@@ -313,6 +330,7 @@ namespace fields {
       assert(this->isFourier());
       assert(covariance.isFourier());
       assert(&covariance.getGrid() == &this->getGrid());
+      tools::profiling::ScopedTimer timer("apply_transfer");
       auto grid = this->getGrid();
       forEachFourierCellInt([&grid, this, &covariance, power]
                                     (T existingValue, int kx, int ky, int kz) {
@@ -498,7 +516,7 @@ namespace fields {
   protected:
 
 
-    const numerics::LocalUnitTricubicApproximation<DataType> getTricubicInterpolatorCached(int x_p_0, int y_p_0, int z_p_0) const {
+    const numerics::LocalUnitTricubicApproximation<InterpolationType> getTricubicInterpolatorCached(int x_p_0, int y_p_0, int z_p_0) const {
       assert(cache::enabled);
       auto key = std::make_tuple(x_p_0, y_p_0, z_p_0, static_cast<const void *>(this));
       auto result = cache::cachedInterpolators.get(key);
@@ -512,9 +530,9 @@ namespace fields {
       }
     }
 
-    numerics::LocalUnitTricubicApproximation<DataType> makeTricubicInterpolator(int x_p_0, int y_p_0, int z_p_0) const {
+    numerics::LocalUnitTricubicApproximation<InterpolationType> makeTricubicInterpolator(int x_p_0, int y_p_0, int z_p_0) const {
       assert(!this->isFourier());
-      DataType valsForInterpolation[4][4][4];
+      InterpolationType valsForInterpolation[4][4][4];
       for(int i=-1; i<3; ++i) {
         for(int j=-1; j<3; ++j) {
           for(int k=-1; k<3; ++k) {
@@ -530,8 +548,136 @@ namespace fields {
           }
         }
       }
-      return numerics::LocalUnitTricubicApproximation<DataType>(valsForInterpolation);
+      return numerics::LocalUnitTricubicApproximation<InterpolationType>(valsForInterpolation);
+    }
+
+#ifdef CUBIC_INTERPOLATION
+    /*! \brief Add a field stored on a coarser grid whose cells are an integer number of our cells across
+     *
+     * Every cell centroid on this grid then sits at one of only `ratio` fractional offsets (in each direction) from
+     * the coarse centroid below it. The 1D cubic weights are tabulated once per offset, and the tricubic interpolation
+     * (which is separable) is applied as successive passes in x, then y, then z, accumulating directly into this
+     * field. The result matches evaluating evaluateInterpolated at each of our cell centroids, up to rounding.
+     *
+     * Returns false, leaving this field untouched, if the grids are not related in this simple way. The caller must
+     * then fall back to the general evaluator.
+     */
+    bool addFieldFromCoarserGridSeparable(const Field<DataType, CoordinateType> &source) {
+      const grids::Grid<CoordinateType> &sourceGrid = source.getGrid();
+      const grids::Grid<CoordinateType> &targetGrid = getGrid();
+
+      if (typeid(sourceGrid) != typeid(grids::Grid<CoordinateType>) ||
+          typeid(targetGrid) != typeid(grids::Grid<CoordinateType>) ||
+          targetGrid.cellSize >= sourceGrid.cellSize ||
+          targetGrid.periodicDomainSize != sourceGrid.periodicDomainSize)
+        return false;
+
+      const int ratio = int(tools::getRatioAndAssertPositiveInteger(sourceGrid.cellSize, targetGrid.cellSize));
+      const int sourceSize = int(sourceGrid.size);
+      const int targetSize = int(targetGrid.size);
+      const int simSizeFine = int(targetGrid.simEquivalentSize);
+      const bool sourceIsPeriodic = sourceGrid.size == sourceGrid.simEquivalentSize;
+      const auto relativeOffset = targetGrid.offsetLower - sourceGrid.offsetLower;
+
+      // Weights for each possible offset of a fine centroid relative to the coarse centroid to its bottom-left
+      std::vector<std::array<CoordinateType, 4>> weightsForOffset(ratio);
+      for (int m = 0; m < ratio; ++m) {
+        CoordinateType dx = (CoordinateType(m) + 0.5) / ratio - 0.5;
+        if (dx < 0) dx += 1;
+        numerics::getCubicWeightsForPosition(dx, weightsForOffset[m].data());
+      }
+
+      auto floorDivide = [](int a, int b) {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+      };
+
+      // For each direction, work out which coarse cells feed each fine cell. Coarse cells are numbered locally from
+      // the lowest one required, so that the passes below only touch the part of the source that is needed.
+      std::vector<int> stencilStart[3], offsetType[3], sourceCells[3];
+
+      for (int d = 0; d < 3; ++d) {
+        int firstFine = tools::getRatioAndAssertInteger(relativeOffset[d], targetGrid.cellSize);
+        firstFine = ((firstFine % simSizeFine) + simSizeFine) % simSizeFine;
+
+        // Cells outside a non-periodic source are left alone by the general evaluator; don't try to replicate that here
+        if (!sourceIsPeriodic && firstFine + targetSize > sourceSize * ratio)
+          return false;
+
+        auto coarseBelow = [&](int fine) { return floorDivide(2 * fine + 1 - ratio, 2 * ratio); };
+        const int lowest = coarseBelow(firstFine) - 1;
+        const int highest = coarseBelow(firstFine + targetSize - 1) + 2;
+
+        for (int i = 0; i < targetSize; ++i) {
+          int fine = firstFine + i;
+          stencilStart[d].push_back(coarseBelow(fine) - 1 - lowest);
+          offsetType[d].push_back(fine % ratio);
+        }
+
+        for (int c = lowest; c <= highest; ++c) {
+          if (sourceIsPeriodic)
+            sourceCells[d].push_back(((c % sourceSize) + sourceSize) % sourceSize);
+          else
+            sourceCells[d].push_back(std::min(std::max(c, 0), sourceSize - 1));
+        }
+      }
+
+      const int ny = int(sourceCells[1].size()), nz = int(sourceCells[2].size());
+      const auto &sourceData = source.getDataVector();
+
+      // x pass: interpolate onto our x positions, at the coarse y and z positions
+      std::vector<DataType> xPass(size_t(targetSize) * ny * nz);
+
+#pragma omp parallel for schedule(static)
+      for (int i = 0; i < targetSize; ++i) {
+        const auto &w = weightsForOffset[offsetType[0][i]];
+        const int start = stencilStart[0][i];
+        for (int ly = 0; ly < ny; ++ly) {
+          DataType *out = &xPass[(size_t(i) * ny + ly) * nz];
+          for (int lz = 0; lz < nz; ++lz)
+            out[lz] = 0;
+          for (int a = 0; a < 4; ++a) {
+            const size_t rowStart = (size_t(sourceCells[0][start + a]) * sourceSize + sourceCells[1][ly]) * sourceSize;
+            for (int lz = 0; lz < nz; ++lz)
+              out[lz] += w[a] * sourceData[rowStart + sourceCells[2][lz]];
+          }
+        }
+      }
+
+      // y then z passes, one x slab at a time, accumulating into our own data
+#pragma omp parallel
+      {
+        std::vector<DataType> yPass(size_t(targetSize) * nz);
+
+#pragma omp for schedule(static)
+        for (int i = 0; i < targetSize; ++i) {
+          for (int j = 0; j < targetSize; ++j) {
+            const auto &w = weightsForOffset[offsetType[1][j]];
+            const int start = stencilStart[1][j];
+            DataType *out = &yPass[size_t(j) * nz];
+            for (int lz = 0; lz < nz; ++lz)
+              out[lz] = 0;
+            for (int a = 0; a < 4; ++a) {
+              const DataType *in = &xPass[(size_t(i) * ny + start + a) * nz];
+              for (int lz = 0; lz < nz; ++lz)
+                out[lz] += w[a] * in[lz];
+            }
+          }
+
+          for (int j = 0; j < targetSize; ++j) {
+            const DataType *in = &yPass[size_t(j) * nz];
+            DataType *out = &data[(size_t(i) * targetSize + j) * targetSize];
+            for (int k = 0; k < targetSize; ++k) {
+              const auto &w = weightsForOffset[offsetType[2][k]];
+              const DataType *stencil = in + stencilStart[2][k];
+              out[k] += w[0] * stencil[0] + w[1] * stencil[1] + w[2] * stencil[2] + w[3] * stencil[3];
+            }
+          }
+        }
+      }
+
+      return true;
     }
+#endif
 
   public:
 
@@ -574,6 +720,7 @@ namespace fields {
     */
     void toFourier() {
       if (fourier) return;
+      tools::profiling::ScopedTimer timer("fft");
       fourierManager->performTransform();
       assert(fourier);
     }
@@ -584,6 +731,7 @@ namespace fields {
     */
     void toReal() {
       if (!fourier) return;
+      tools::profiling::ScopedTimer timer("fft");
       fourierManager->performTransform();
       assert(!fourier);
     }
@@ -654,11 +802,21 @@ namespace fields {
       const_cast<FourierManager &>(*fourierManager).ensureFourierModesAreMirrored();
     }
 
+    //! Tabulate a filter expression over the integer |k|^2 values present on this field's grid
+    filters::TabulatedFilter<CoordinateType> tabulateFilter(const filters::Filter<CoordinateType> &filter) const {
+      return filters::TabulatedFilter<CoordinateType>(filter, getGrid().getFourierKmin(),
+                                                      static_cast<int>(getGrid().size / 2));
+    }
+
     //! Apply a Fourier space filter that suppresses the field at some k
     void applyFilter(const filters::Filter<CoordinateType> &filter) {
-      forEachFourierCell([&filter](ComplexType current_value, CoordinateType kx, CoordinateType ky, CoordinateType kz) {
-        CoordinateType k = sqrt(double(kx * kx + ky * ky + kz * kz));
-        return current_value * filter(k);
+      applyFilter(tabulateFilter(filter));
+    }
+
+    //! Apply a Fourier space filter that has already been tabulated for this grid
+    void applyFilter(const filters::TabulatedFilter<CoordinateType> &filter) {
+      forEachFourierCellInt([&filter](ComplexType current_value, int kx, int ky, int kz) {
+        return current_value * filter(kx * kx + ky * ky + kz * kz);
       });
     }
 
@@ -668,6 +826,12 @@ namespace fields {
      */
     void applyFilterInWindow(const filters::Filter<CoordinateType> &filter, const Window<CoordinateType> & window,
                              bool windowFirst) {
+      applyFilterInWindow(tabulateFilter(filter), window, windowFirst);
+    }
+
+    //! As applyFilterInWindow above, but for a filter that has already been tabulated for this grid
+    void applyFilterInWindow(const filters::TabulatedFilter<CoordinateType> &filter,
+                             const Window<CoordinateType> & window, bool windowFirst) {
       using tools::numerics::operator+=;
 
       auto inWindow = this->copy();
@@ -721,6 +885,14 @@ namespace fields {
     void addFieldFromDifferentGrid(const Field<DataType, CoordinateType> &source) {
       assert(!source.isFourier());
       toReal();
+
+      tools::profiling::ScopedTimer timer("interpolate");
+
+#ifdef CUBIC_INTERPOLATION
+      if (addFieldFromCoarserGridSeparable(source))
+        return;
+#endif
+
       TPtrGrid pSourceProxyGrid = source.getGrid().makeProxyGridToMatch(getGrid());
 
       auto evaluator = makeEvaluator(source, *pSourceProxyGrid);
@@ -782,6 +954,62 @@ namespace fields {
         addFieldFromDifferentGridWithFilter(const_cast<const Field<DataType, CoordinateType> &>(source), filter);
       }
 
+    /*! \brief Replace this field by its high-pass filtered self plus the low-pass filtered source from another grid.
+
+        Equivalent to applyFilter(highPassFilter) followed by addFieldFromDifferentGridWithFilter(source, lowPassFilter),
+        but the temporary holding the filtered source is a caller-owned scratch field, so that callers recombining
+        several fields can share one temporary rather than allocating a new one per call. Unless FILTER_ON_COARSE_GRID
+        is defined, both filters and the addition are also applied in a single pass over Fourier space.
+
+        \param source - field on a different grid, converted to real space if required
+        \param highPassFilter - filter to apply to this field
+        \param lowPassFilter - filter to apply to the source
+        \param pScratch - workspace; allocated on the grid it needs to be on if it is null or on another grid, and
+                          otherwise overwritten
+    */
+    void combineWithFieldFromDifferentGrid(Field<DataType, CoordinateType> &source,
+                                           const filters::Filter<CoordinateType> &highPassFilter,
+                                           const filters::Filter<CoordinateType> &lowPassFilter,
+                                           std::shared_ptr<Field<DataType, CoordinateType>> &pScratch) {
+#ifdef FILTER_ON_COARSE_GRID
+      // The source is filtered on its own grid before interpolation, so the scratch space lives on the source grid
+      if (pScratch == nullptr || &pScratch->getGrid() != &source.getGrid())
+        pScratch = std::make_shared<Field<DataType, CoordinateType>>(source.getGrid(), source.isFourier());
+
+      pScratch->getDataVector() = source.getDataVector();
+      pScratch->setFourier(source.isFourier());
+      pScratch->applyFilter(lowPassFilter);
+      pScratch->toReal();
+
+      this->applyFilter(highPassFilter);
+      this->toReal();
+      this->addFieldFromDifferentGrid(const_cast<const Field<DataType, CoordinateType> &>(*pScratch));
+#else
+      if (pScratch == nullptr || &pScratch->getGrid() != &getGrid())
+        pScratch = std::make_shared<Field<DataType, CoordinateType>>(getGrid(), false);
+
+      source.toReal();
+
+      pScratch->setFourier(false);
+      auto &scratchData = pScratch->getDataVector();
+      std::fill(scratchData.begin(), scratchData.end(), DataType(0));
+      pScratch->addFieldFromDifferentGrid(const_cast<const Field<DataType, CoordinateType> &>(source));
+      pScratch->toFourier();
+
+      this->toFourier();
+
+      auto highPassTable = tabulateFilter(highPassFilter);
+      auto lowPassTable = tabulateFilter(lowPassFilter);
+      const Field<DataType, CoordinateType> &lowPassSource = *pScratch;
+      forEachFourierCellInt([&highPassTable, &lowPassTable, &lowPassSource]
+                              (ComplexType current_value, int kx, int ky, int kz) {
+        int kSquared = kx * kx + ky * ky + kz * kz;
+        return current_value * highPassTable(kSquared) +
+               lowPassSource.getFourierCoefficient(kx, ky, kz) * lowPassTable(kSquared);
+      });
+#endif
+    }
+
     //! Outputs the field as a numpy array to the specified filename.
     void dumpGridData(std::string filename) const {
       int n = static_cast<int>(getGrid().size);
@@ -798,7 +1026,9 @@ namespace fields {
         throw std::runtime_error("Incorrect size for imported numpy array");
       }
       assert(data.size() == getGrid().size3);
+      size_t loadedSize = data.size();
       data.resize(fourierManager->getRequiredDataSize());
+      tools::storage::fillInParallel(data, DataType(0), loadedSize);
     }
 
     auto copy() const {
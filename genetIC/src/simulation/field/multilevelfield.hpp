@@ -273,7 +273,7 @@ namespace fields {
       }
 
       const Field<DataType> *pFieldThis, *pFieldOther;
-      const std::vector<DataType> *pFieldDataThis;
+      const typename Field<DataType>::TData *pFieldDataThis;
 
       ComplexType result(0, 0);
 
@@ -354,8 +354,9 @@ namespace fields {
         auto & f = filters.getFilterForLevel(level);
         if(toCovector && level < getNumLevels()-1) {
           auto window = multiLevelContext->getGridForLevel(level+1).getWindow();
-          result->applyFilterInWindow(f, window, true);
-          result->applyFilterInWindow(f, window, false);
+          auto fTable = result->tabulateFilter(f);
+          result->applyFilterInWindow(fTable, window, true);
+          result->applyFilterInWindow(fTable, window, false);
         } else
           result->applyFilter(f*f);
 
@@ -467,28 +468,107 @@ namespace fields {
       // multi-level fields it would presumably require a lot of work (because of the need to implement
       // convertToCovector in this arbitrary case).
 
-      bool returnToReal = false;
-      if(!this->isFourierOnAllLevels()) {
-        // technically converting to fourier violates const correctness, but we'll put it right below
-        const_cast<MultiLevelField<DataType>*>(this)->toFourier();
-        returnToReal = true;
+      auto filters = getFilters();
+      T chi2 = 0;
+      for (size_t level = 0; level < getNumLevels(); ++level)
+        chi2 += getChi2ContributionFromLevel(level, filters);
+
+      return chi2;
+    }
+
+
+  private:
+
+    /*! \brief Returns x_l . (C^-1 x)_l for level l, the contribution of one level to the chi^2
+
+        This is the same quantity as convertToCovector followed by innerProduct would give, but without copying the
+        whole field. Nor is this field transformed; each term is evaluated in whichever space the level is stored in.
+        A scratch field on this level's grid is used first for the diagonal term and then reused to gather the
+        cross-level terms one source level at a time, so at most a couple of single-level temporaries are alive.
+
+        The diagonal term follows applyMetric. On the finest level it is the sum of f^2 |x_k|^2. On coarser levels the
+        two windowed filter passes combine, because the filter is symmetric and the window a projection, into
+        |y|^2 where y = (1-W) x + F W x = x - (1-F) W x.
+    */
+    T getChi2ContributionFromLevel(size_t level, const filters::FilterFamilyBase<T> &filters) const {
+      const Field<DataType> &field = getFieldForLevel(level);
+      const size_t size3 = field.getGrid().size3;
+      T chi2 = 0;
+
+      auto &filter = filters.getFilterForLevel(level);
+      std::shared_ptr<Field<DataType>> pScratch = field.copy();
+
+      if (level < getNumLevels() - 1) {
+        auto window = multiLevelContext->getGridForLevel(level + 1).getWindow();
+        pScratch->setZeroOutsideWindow(window);
+        pScratch->toFourier();
+        pScratch->applyFilter(filters::ComplementaryFilterAdaptor<filters::Filter<T>>(filter));
+
+        if (field.isFourier()) {
+          const Field<DataType> &correction = *pScratch;
+          chi2 += field.accumulateForEachFourierCell([&correction](ComplexType value, int kx, int ky, int kz) {
+            return ComplexType(std::norm(value - correction.getFourierCoefficient(kx, ky, kz)));
+          }).real();
+        } else {
+          pScratch->toReal();
+#pragma omp parallel for reduction(+:chi2)
+          for (size_t i = 0; i < size3; ++i) {
+            T y = field[i] - (*pScratch)[i];
+            chi2 += y * y;
+          }
+        }
+      } else {
+        pScratch->toFourier();
+        auto filterTable = pScratch->tabulateFilter(filter);
+        chi2 += pScratch->accumulateForEachFourierCell([&filterTable](ComplexType value, int kx, int ky, int kz) {
+          T filterValue = filterTable(kx * kx + ky * ky + kz * kz);
+          return ComplexType(filterValue * filterValue * std::norm(value));
+        }).real();
       }
 
-      auto self_copy = fields::MultiLevelField<DataType>(*this);
-      self_copy.convertToCovector();
-      T chi2 = self_copy.innerProduct(*this).real();
+      if (getNumLevels() == 1)
+        return chi2;
+
+      // Cross-level terms, as in applyMetric
+      pScratch->setFourier(false);
+      tools::storage::fillInParallel(pScratch->getDataVector(), DataType(0));
 
-      if(returnToReal) {
-        // Fix the const violation above
-        const_cast<MultiLevelField<DataType>*>(this)->toReal();
+      for (size_t sourceLevel = 0; sourceLevel < getNumLevels(); ++sourceLevel) {
+        if (sourceLevel == level)
+          continue;
+
+        T pixelVolumeRatio = multiLevelContext->getWeightForLevel(level) /
+                             multiLevelContext->getWeightForLevel(sourceLevel);
+        auto crossFilter = filter * filters.getFilterForLevel(sourceLevel) * sqrt(pixelVolumeRatio);
+
+        const Field<DataType> &source = getFieldForLevel(sourceLevel);
+#ifndef FILTER_ON_COARSE_GRID
+        if (source.isFourier()) {
+          auto pRealSource = source.copy();
+          pRealSource->toReal();
+          pScratch->addFieldFromDifferentGridWithFilter(*pRealSource, crossFilter);
+          continue;
+        }
+#endif
+        pScratch->addFieldFromDifferentGridWithFilter(source, crossFilter);
+      }
+
+      if (field.isFourier()) {
+        pScratch->toFourier();
+        const Field<DataType> &crossTerms = *pScratch;
+        chi2 += field.accumulateForEachFourierCell([&crossTerms](ComplexType value, int kx, int ky, int kz) {
+          return ComplexType(std::real(std::conj(value) * crossTerms.getFourierCoefficient(kx, ky, kz)));
+        }).real();
+      } else {
+        pScratch->toReal();
+#pragma omp parallel for reduction(+:chi2)
+        for (size_t i = 0; i < size3; ++i)
+          chi2 += field[i] * (*pScratch)[i];
       }
 
       return chi2;
     }
 
-
-  private:
-
     //! Apply 'exact' power spectrum on a single grid:
     /*!
     \param field - field to apply to
@@ -568,6 +648,14 @@ namespace fields {
       return *(this->fieldsOnLevels[i]);
     }
 
+    //! Exchange the data on all levels, and the transfer function applied to them, with another field on the same context
+    void swap(OutputField<DataType> &other) {
+      assert(this->multiLevelContext == other.multiLevelContext);
+      std::swap(this->fieldsOnLevels, other.fieldsOnLevels);
+      std::swap(this->transferType, other.transferType);
+      std::swap(fieldsOnLevelsPopulated, other.fieldsOnLevelsPopulated);
+    }
+
 
   };
 
@@ -604,6 +692,40 @@ namespace fields {
 
 
   };
+
+  /*! \class CompactMultiLevelField
+    \brief A read-only real-space field across the levels of a multi-level context, stored in single precision.
+
+    Holds results that only need to be evaluated, such as the Zeldovich offsets when memory is short, in half the
+    space of a MultiLevelField. Evaluators are made with makeEvaluatorForLevels<float>; interpolation is still carried
+    out in double precision.
+  */
+  template<typename DataType, typename StorageType = float>
+  class CompactMultiLevelField {
+  public:
+    using T = tools::datatypes::strip_complex<DataType>;
+
+  protected:
+    const multilevelgrid::MultiLevelGrid<DataType> *multiLevelContext; //!< Pointer to the underlying multi-level context
+    std::vector<std::shared_ptr<Field<StorageType, T>>> fieldsOnLevels; //!< The compact fields on each level
+
+  public:
+    //! Constructor from the compact fields on each level of the given context
+    CompactMultiLevelField(const multilevelgrid::MultiLevelGrid<DataType> &multiLevelContext,
+                           std::vector<std::shared_ptr<Field<StorageType, T>>> fieldsOnLevels) :
+      multiLevelContext(&multiLevelContext), fieldsOnLevels(std::move(fieldsOnLevels)) {
+      assert(this->fieldsOnLevels.size() == multiLevelContext.getNumLevels());
+    }
+
+    //! Returns a constant reference to the field on the specified grid.
+    const Field<StorageType, T> &getFieldForGrid(const grids::Grid<T> &grid) const {
+      for (size_t i = 0; i < multiLevelContext->getNumLevels(); ++i) {
+        if (grid.isProxyFor(&multiLevelContext->getGridForLevel(i)))
+          return *(fieldsOnLevels[i]);
+      }
+      throw (std::runtime_error("Cannot find a field for the specified grid"));
+    }
+  };
 }
 
 #endif
@@ -7,6 +7,7 @@
 #include <gsl/gsl_spline.h>
 
 #include "src/simulation/grid/grid.hpp"
+#include "src/io/cache.hpp"
 
 namespace fields {
 
@@ -44,6 +45,7 @@ namespace fields {
       gsl_rng_set(randomState, seed);
       this->baseSeed = seed;
       drawInFourierSpace = false;
+      reverseRandomDrawOrder = false;
       seeded = false;
       parallel = false;
     }
@@ -82,7 +84,7 @@ namespace fields {
       gsl_rng_free(randomState);
     }
 
-    using RefFieldType = std::vector<DataType> &;
+    using RefFieldType = typename fields::Field<DataType>::TData &;
     using FieldType = std::remove_reference_t<RefFieldType>;
 
 
@@ -117,12 +119,33 @@ namespace fields {
       }
     }
 
+    //! Returns true if a seed has been set
+    bool isSeeded() const {
+      return seeded;
+    }
+
     //! Draws random numbers for multi level field.
+    /*!
+     * If the on-disk cache is enabled, the draw for each level is loaded from it when available, along with the state
+     * of the generator afterwards so that the draws on any subsequent levels continue as normal.
+     */
     void draw() {
       if (!seeded)
         throw std::runtime_error("The random number generator has not been seeded");
+
+      // The draw on each level depends on the settings and, in serial modes, on the draws on all earlier levels
+      io::cache::Hasher hash("white_noise");
+      hash.add(drawInFourierSpace).add(reverseRandomDrawOrder).add(parallel).add(baseSeed);
+
       for (size_t i = 0; i < field.getNumLevels(); ++i) {
         auto &fieldOnGrid = field.getFieldForLevel(i);
+        hash.add(fieldOnGrid.getGrid().thisGridSize).add(fieldOnGrid.getGrid().size);
+
+        if (loadFromCache(hash, fieldOnGrid)) {
+          logging::entry() << "Loaded random numbers for level " << i << " from cache" << std::endl;
+          continue;
+        }
+
         if(i==0)
           logging::entry() << "Drawing random numbers (base grid)" << std::endl;
         else
@@ -134,11 +157,35 @@ namespace fields {
         } else {
           drawRandomForSpecifiedGrid(fieldOnGrid);
         }
+
+        saveToCache(hash, fieldOnGrid);
       }
     }
 
   protected:
 
+    //! Load a previous draw and the subsequent generator state from the on-disk cache; returns false if unavailable
+    bool loadFromCache(const io::cache::Hasher &key, Field <DataType> &fieldOnGrid) {
+      std::vector<char> generatorState;
+      bool fourier;
+      if (!io::cache::load<DataType>(key, fieldOnGrid.getDataVector(), fourier, &generatorState))
+        return false;
+      if (generatorState.size() != gsl_rng_size(randomState))
+        throw std::runtime_error("Cached random number generator state has the wrong size");
+      std::memcpy(gsl_rng_state(randomState), generatorState.data(), generatorState.size());
+      fieldOnGrid.setFourier(fourier);
+      return true;
+    }
+
+    //! Store a draw and the subsequent generator state in the on-disk cache, if it is enabled
+    void saveToCache(const io::cache::Hasher &key, const Field <DataType> &fieldOnGrid) const {
+      if (!io::cache::isEnabled())
+        return;
+      const char *state = static_cast<const char *>(gsl_rng_state(randomState));
+      std::vector<char> generatorState(state, state + gsl_rng_size(randomState));
+      io::cache::save<DataType>(key, fieldOnGrid.getDataVector(), fieldOnGrid.isFourier(), generatorState);
+    }
+
     //! Draws a random number for a given Fourier mode.
     void drawOneFourierMode(Field <DataType> &field, int k1, int k2, int k3,
                             FloatType norm, gsl_rng *localRandomState) {
@@ -201,7 +248,7 @@ namespace fields {
     */
     void drawRandomForSpecifiedGridFourier(Field <DataType> &field) {
 
-      std::vector<DataType> &vec = field.getDataVector();
+      auto &vec = field.getDataVector();
 
       std::fill(vec.begin(), vec.end(), DataType(0));
 
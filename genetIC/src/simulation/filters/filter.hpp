@@ -1,7 +1,10 @@
 #ifndef IC_FILTER_HPP
 #define IC_FILTER_HPP
 
+#include <cassert>
 #include <stdexcept>
+#include <vector>
+#include <cmath>
 /*!
     \namespace filters
     \brief Define the filters used to separate low and high k modes in the box
@@ -315,6 +318,41 @@ namespace filters {
       s << "ComplementaryFilterAdaptor(" << (*pUnderlying) << ")";
     }
   };
+
+  /*! \class TabulatedFilter
+      \brief Any filter expression evaluated once for a grid, and then looked up by integer |k|^2.
+
+      On a grid the wavenumber only enters through kx^2+ky^2+kz^2 in units of the fundamental mode, which takes at
+      most 3(n/2)^2+1 values. Tabulating over that range replaces the exp/sqrt and chained virtual calls of a composite
+      filter by one lookup per Fourier cell, at the cost of O(n^2) evaluations.
+  */
+  template<typename T>
+  class TabulatedFilter {
+  protected:
+    std::vector<T> values; //!< Filter value at k = kMin*sqrt(i) for each integer i
+
+  public:
+    //! \brief Tabulate the filter
+    /*!
+    \param filter - filter expression to tabulate
+    \param kMin - fundamental wavenumber of the grid
+    \param maxIntegerK - largest magnitude of any single integer wavenumber component on the grid
+    */
+    TabulatedFilter(const Filter<T> &filter, T kMin, int maxIntegerK) {
+      size_t tableSize = 3 * size_t(maxIntegerK) * size_t(maxIntegerK) + 1;
+      values.resize(tableSize);
+
+#pragma omp parallel for schedule(static)
+      for (size_t i = 0; i < tableSize; ++i)
+        values[i] = filter(kMin * T(sqrt(double(i))));
+    }
+
+    //! Returns the filter at the mode with integer wavenumber satisfying kx^2+ky^2+kz^2 = kSquared
+    T operator()(int kSquared) const {
+      assert(kSquared >= 0 && size_t(kSquared) < values.size());
+      return values[kSquared];
+    }
+  };
 }
 
 #endif //IC_FILTER_HPP
@@ -0,0 +1,174 @@
+#ifndef IC_FLAGBITMAP_HPP
+#define IC_FLAGBITMAP_HPP
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include "src/tools/util_functions.hpp"
+
+namespace grids {
+
+  /*! \class CellFlagBitmap
+      \brief One bit per cell of a grid, used for fast set operations on flagged cells.
+
+      Grids store their flags as a sorted vector of cell indices, which is what the rest of the code consumes. For
+      large flagged regions, however, unions and dilations are much faster on a bitmap, since they become word-wide
+      bitwise operations that can be carried out in parallel with no sorting. This class provides the conversions
+      in both directions as well as the dilation itself.
+  */
+  class CellFlagBitmap {
+  protected:
+    using WordType = uint64_t;
+    static constexpr size_t bitsPerWord = 64;
+
+    size_t nCells; //!< Number of cells (bits) represented
+    std::vector<WordType> words; //!< Bitmap storage; bit i of the whole bitmap is cell i
+
+    //! Returns the 64 bits starting from bit position 'start', which may lie partially or wholly outside the bitmap
+    WordType getBitsStartingFrom(long long start) const {
+      const long long nWords = static_cast<long long>(words.size());
+      long long wordIndex = start >= 0 ? start / long(bitsPerWord) : -((-start + long(bitsPerWord) - 1) / long(bitsPerWord));
+      int shift = int(start - wordIndex * long(bitsPerWord));
+
+      WordType lower = (wordIndex >= 0 && wordIndex < nWords) ? words[wordIndex] : 0;
+      if (shift == 0)
+        return lower;
+      WordType upper = (wordIndex + 1 >= 0 && wordIndex + 1 < nWords) ? words[wordIndex + 1] : 0;
+      return (lower >> shift) | (upper << (bitsPerWord - shift));
+    }
+
+    //! Returns a mask of the bits in the word starting at firstBit whose positions i satisfy (i mod period) < threshold
+    static WordType getMaskBelowWithinPeriod(size_t firstBit, size_t period, size_t threshold) {
+      WordType mask = 0;
+      size_t lastBit = firstBit + bitsPerWord; // exclusive
+      for (size_t runStart = (firstBit / period) * period; runStart < lastBit; runStart += period) {
+        size_t from = std::max(runStart, firstBit);
+        size_t to = std::min(runStart + threshold, lastBit);
+        if (to > from) {
+          size_t n = to - from;
+          WordType run = n == bitsPerWord ? ~WordType(0) : ((WordType(1) << n) - 1);
+          mask |= run << (from - firstBit);
+        }
+      }
+      return mask;
+    }
+
+    //! Zero any bits in the final word beyond the end of the represented cells
+    void clearPadding() {
+      size_t nUsedInLastWord = nCells % bitsPerWord;
+      if (nUsedInLastWord != 0 && !words.empty())
+        words.back() &= (WordType(1) << nUsedInLastWord) - 1;
+    }
+
+  public:
+    //! Construct a bitmap for the specified number of cells, all unflagged
+    explicit CellFlagBitmap(size_t nCells) : nCells(nCells), words((nCells + bitsPerWord - 1) / bitsPerWord) {
+
+    }
+
+    //! Flag all the cells in the supplied vector of indices, which need not be sorted or unique
+    void flagCells(const std::vector<size_t> &cells) {
+      WordType *data = words.data();
+#pragma omp parallel for
+      for (size_t i = 0; i < cells.size(); ++i) {
+        assert(cells[i] < nCells);
+        WordType bit = WordType(1) << (cells[i] % bitsPerWord);
+#pragma omp atomic
+        data[cells[i] / bitsPerWord] |= bit;
+      }
+    }
+
+    /*! \brief Dilate the flagged cells by up to nSteps steps of the given stride.
+
+       The bitmap is regarded as a sequence of blocks of length period; a step of stride moves from cell i to cell
+       i+stride within the same block. For a grid of side n, stride/period of 1/n, n/n^2 and n^2/n^3 give steps in
+       z, y and x respectively. If periodic is true, steps off one end of a block wrap round to the other end;
+       otherwise they are discarded.
+    */
+    void dilate(size_t stride, size_t period, size_t nSteps, bool periodic) {
+      std::vector<WordType> result(words);
+      const size_t nWords = words.size();
+
+      for (size_t step = 1; step <= nSteps; ++step) {
+        const size_t shift = step * stride;
+        if (shift >= period) break; // steps this long would only revisit cells that are already covered
+
+#pragma omp parallel for schedule(static)
+        for (size_t w = 0; w < nWords; ++w) {
+          const size_t firstBit = w * bitsPerWord;
+          const long long start = static_cast<long long>(firstBit);
+
+          // Stepping upwards: cell i receives from i-shift, or (wrapping) from i-shift+period
+          WordType wrapsUp = getMaskBelowWithinPeriod(firstBit, period, shift);
+          WordType accum = getBitsStartingFrom(start - shift) & ~wrapsUp;
+          if (periodic)
+            accum |= getBitsStartingFrom(start - shift + period) & wrapsUp;
+
+          // Stepping downwards: cell i receives from i+shift, or (wrapping) from i+shift-period
+          WordType noWrapDown = getMaskBelowWithinPeriod(firstBit, period, period - shift);
+          accum |= getBitsStartingFrom(start + shift) & noWrapDown;
+          if (periodic)
+            accum |= getBitsStartingFrom(start + shift - period) & ~noWrapDown;
+
+          result[w] |= accum;
+        }
+      }
+
+      words = std::move(result);
+      clearPadding();
+    }
+
+    //! Returns the sorted, unique indices of all flagged cells
+    std::vector<size_t> getFlaggedCells() const {
+      const size_t nWords = words.size();
+      const size_t blockSize = 4096; // words per parallel work unit
+      const size_t nBlocks = (nWords + blockSize - 1) / blockSize;
+      std::vector<size_t> countsBeforeBlock(nBlocks + 1, 0);
+
+#pragma omp parallel for schedule(static)
+      for (size_t b = 0; b < nBlocks; ++b) {
+        size_t count = 0;
+        for (size_t w = b * blockSize; w < std::min(nWords, (b + 1) * blockSize); ++w)
+          count += size_t(__builtin_popcountll(words[w]));
+        countsBeforeBlock[b + 1] = count;
+      }
+
+      for (size_t b = 0; b < nBlocks; ++b)
+        countsBeforeBlock[b + 1] += countsBeforeBlock[b];
+
+      std::vector<size_t> result(countsBeforeBlock[nBlocks]);
+
+#pragma omp parallel for schedule(static)
+      for (size_t b = 0; b < nBlocks; ++b) {
+        size_t out = countsBeforeBlock[b];
+        for (size_t w = b * blockSize; w < std::min(nWords, (b + 1) * blockSize); ++w) {
+          WordType word = words[w];
+          while (word != 0) {
+            result[out++] = w * bitsPerWord + size_t(__builtin_ctzll(word));
+            word &= word - 1;
+          }
+        }
+      }
+
+      return result;
+    }
+  };
+
+  /*! \brief Sort a vector of cell indices and remove duplicates, using a bitmap when that is likely to be faster.
+   *
+   * The bitmap costs time proportional to the number of cells in the grid, so it only pays off when the vector is
+   * not too sparse; otherwise this falls back to an ordinary sort.
+   */
+  inline void sortAndEraseDuplicateCells(std::vector<size_t> &cells, size_t nCellsInGrid) {
+    if (cells.size() > nCellsInGrid / 64) {
+      CellFlagBitmap bitmap(nCellsInGrid);
+      bitmap.flagCells(cells);
+      cells = bitmap.getFlaggedCells();
+    } else {
+      tools::sortAndEraseDuplicate(cells);
+    }
+  }
+}
+
+#endif
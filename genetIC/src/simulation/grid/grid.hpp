@@ -7,12 +7,17 @@
 #include <memory>
 #include <vector>
 #include <complex>
+#include <algorithm>
+#include <limits>
+#include <typeinfo>
 #include "src/tools/numerics/fourier.hpp"
 #include "src/simulation/coordinate.hpp"
 #include "src/tools/progress/progress.hpp"
 #include "src/tools/util_functions.hpp"
 #include "src/tools/data_types/complex.hpp"
 #include "src/simulation/window.hpp"
+#include "src/simulation/grid/flagbitmap.hpp"
+#include "src/simulation/grid/indexing.hpp"
 #include "boost/config.hpp"
 
 using std::complex;
@@ -91,6 +96,13 @@ namespace grids {
     const size_t simEquivalentSize; //!< the total number of cells on the box side of a simulation if it were all at this resolution
     const T cellMassFrac; //!< the fraction of mass of the full simulation in a single cell of this grid
     const T cellSofteningScale; //!< normally 1.0; scales softening relative to dx
+    const bool sizeIsPowerOfTwo; //!< whether index arithmetic can use shifts and masks; see withIndexing
+
+  protected:
+    const GeneralIndexing generalIndexing; //!< index arithmetic for a grid of this size
+    const PowerOfTwoIndexing powerOfTwoIndexing; //!< index arithmetic by shifts and masks, if sizeIsPowerOfTwo
+
+  public:
 
     /*! \brief Detailed constructor - supply all properties
 
@@ -110,7 +122,7 @@ namespace grids {
       size(n), size2(n * n), size3(n * n * n),
       simEquivalentSize((unsigned) tools::getRatioAndAssertInteger(simsize, dx)),
       cellMassFrac(massFrac == 0.0 ? pow(dx / simsize, 3.0) : massFrac),
-      cellSofteningScale(softScale) {
+      cellSofteningScale(softScale), sizeIsPowerOfTwo(isPowerOfTwo(n)), generalIndexing(n), powerOfTwoIndexing(n) {
       setKmin();
     }
 
@@ -118,7 +130,8 @@ namespace grids {
     explicit Grid(size_t n) : periodicDomainSize(0), thisGridSize(n),
                               cellSize(1.0), offsetLower(0, 0, 0),
                               size(n), size2(n * n), size3(n * n * n), simEquivalentSize(0), cellMassFrac(0.0),
-                              cellSofteningScale(1.0) {
+                              cellSofteningScale(1.0), sizeIsPowerOfTwo(isPowerOfTwo(n)), generalIndexing(n),
+                              powerOfTwoIndexing(n) {
       setKmin();
     }
 
@@ -267,11 +280,28 @@ namespace grids {
 
     //! Flags the cells specified by linear indices in sourceArray
     virtual void flagCells(const std::vector<size_t> &sourceArray) {
-      std::vector<size_t> newFlags(flags.size() + sourceArray.size());
-      auto end = std::set_union(flags.begin(), flags.end(), sourceArray.begin(), sourceArray.end(), newFlags.begin());
+      if (flags.size() + sourceArray.size() > size3 / 64) {
+        // Dense case: a bitmap union is linear in the grid size and needs neither sorting nor merging
+        CellFlagBitmap bitmap(size3);
+        bitmap.flagCells(flags);
+        bitmap.flagCells(sourceArray);
+        flags = bitmap.getFlaggedCells();
+        return;
+      }
+
+      std::vector<size_t> sortedSource;
+      const std::vector<size_t> *pSource = &sourceArray;
+      if (!std::is_sorted(sourceArray.begin(), sourceArray.end())) {
+        sortedSource = sourceArray;
+        std::sort(sortedSource.begin(), sortedSource.end());
+        pSource = &sortedSource;
+      }
+
+      std::vector<size_t> newFlags(flags.size() + pSource->size());
+      auto end = std::set_union(flags.begin(), flags.end(), pSource->begin(), pSource->end(), newFlags.begin());
+      end = std::unique(newFlags.begin(), end);
       newFlags.resize(end - newFlags.begin());
       flags = std::move(newFlags);
-      tools::sortAndEraseDuplicate(flags);
     }
 
     /*! \brief For each existing flag, flags the point one step ahead and one step behind.
@@ -282,21 +312,34 @@ namespace grids {
     virtual void expandFlaggedRegionInDirection(const Coordinate<int> &step) {
       size_t old_size = flags.size();
       flags.resize(old_size * 3);
-      for (size_t i = 0; i < old_size; ++i) {
-        size_t original_cell_id = flags[i];
-        flags[i + old_size] = this->getIndexFromIndexAndStep(original_cell_id, step);
-        flags[i + old_size * 2] = this->getIndexFromIndexAndStep(original_cell_id, -step);
-      }
+
+      withIndexFromIndexAndStep([this, old_size, &step](const auto &getIndexFromIndexAndStep) {
+        for (size_t i = 0; i < old_size; ++i) {
+          size_t original_cell_id = flags[i];
+          flags[i + old_size] = getIndexFromIndexAndStep(original_cell_id, step);
+          flags[i + old_size * 2] = getIndexFromIndexAndStep(original_cell_id, -step);
+        }
+      });
       tools::sortAndEraseDuplicate(flags);
     }
 
-    //! Expands the flagged region by ncells cells in each of the x,y,z directions.
+    /*! \brief Expands the flagged region by ncells cells in each of the x,y,z directions.
+
+     The dilation is performed on a bitmap, one axis at a time, so the cost is proportional to the grid size rather
+     than to repeated sorts of the flag vector. Grids that do not cover the whole simulation do not wrap; cells that
+     would lie outside them are not flagged.
+    */
     virtual void expandFlaggedRegion(size_t ncells = 1) {
-      for (size_t i = 0; i < ncells; i++) {
-        expandFlaggedRegionInDirection({0, 0, 1});
-        expandFlaggedRegionInDirection({0, 1, 0});
-        expandFlaggedRegionInDirection({1, 0, 0});
-      }
+      if (flags.empty() || ncells == 0)
+        return;
+
+      bool periodic = (size == simEquivalentSize);
+      CellFlagBitmap bitmap(size3);
+      bitmap.flagCells(flags);
+      bitmap.dilate(1, size, ncells, periodic);
+      bitmap.dilate(size, size2, ncells, periodic);
+      bitmap.dilate(size2, size3, ncells, periodic);
+      flags = bitmap.getFlaggedCells();
     }
 
     //! Removes all cells flags - used as part of clearing.
@@ -346,8 +389,12 @@ namespace grids {
      * problems seemed to be sufficient for practical purposes. (If a grid is not much bigger than 16^3, the
      * parallelisation will be very poor -- but on the other hand, it's such a small grid that performance is
      * unlikely to be an issue.)
+     *
+     * The callback is a template parameter so that it can be inlined into the loop; see e.g. the composed evaluators
+     * in evaluator.hpp, which rely on this to avoid any indirect calls per cell.
      */
-    void parallelIterateOverCellsSpatiallyClustered(std::function<void(size_t)> callback, int chunk_size=16) const {
+    template<typename CallbackType>
+    void parallelIterateOverCellsSpatiallyClustered(const CallbackType &callback, int chunk_size=16) const {
       // This prevents error when the grid is tiny
       if (chunk_size > int(size))
         chunk_size = size;
@@ -355,23 +402,35 @@ namespace grids {
       size_t nChunks = std::pow(nChunksPerSide,3);
       Grid<T> gridOfChunks(periodicDomainSize, nChunksPerSide, cellSize*chunk_size);
 
-      // Explicit typing of this lambda seems required to prevent Clang linking error (which only shows up
-      // when used in parallel, as below).
-      std::function<void(const Coordinate<int> &)> adaptedCallback = [callback, this](const Coordinate<int> & coord) {
-        callback(this->getIndexFromCoordinate(coord));
+      const int gridSize = int(size);
+      auto iterateOverChunks = [&](const auto &getIndex) {
+#pragma omp parallel for schedule(dynamic) default(none) shared(nChunks, gridOfChunks, chunk_size, callback, getIndex, gridSize)
+        for(size_t chunk=0; chunk<nChunks; chunk++) {
+          auto lci_coordinate = gridOfChunks.getCoordinateFromIndex(chunk) * chunk_size;
+          auto uce_coordinate = lci_coordinate+chunk_size;
+          if(BOOST_UNLIKELY(uce_coordinate.x>gridSize)) uce_coordinate.x = gridSize;
+          if(BOOST_UNLIKELY(uce_coordinate.y>gridSize)) uce_coordinate.y = gridSize;
+          if(BOOST_UNLIKELY(uce_coordinate.z>gridSize)) uce_coordinate.z = gridSize;
+          for (int x = lci_coordinate.x; x < uce_coordinate.x; ++x) {
+            for (int y = lci_coordinate.y; y < uce_coordinate.y; ++y) {
+              for (int z = lci_coordinate.z; z < uce_coordinate.z; ++z) {
+                callback(getIndex(x, y, z));
+              }
+            }
+          }
+        }
       };
 
-#pragma omp parallel for schedule(dynamic) default(none) shared(nChunks, gridOfChunks, chunk_size, adaptedCallback)
-      for(size_t chunk=0; chunk<nChunks; chunk++) {
-        auto lci_coordinate = gridOfChunks.getCoordinateFromIndex(chunk) * chunk_size;
-        auto uce_coordinate = lci_coordinate+chunk_size;
-        if(BOOST_UNLIKELY(uce_coordinate.x>size)) uce_coordinate.x = size;
-        if(BOOST_UNLIKELY(uce_coordinate.y>size)) uce_coordinate.y = size;
-        if(BOOST_UNLIKELY(uce_coordinate.z>size)) uce_coordinate.z = size;
-        iterateOverCube<int>(lci_coordinate, uce_coordinate, adaptedCallback);
+      if (typeid(*this) == typeid(Grid<T>)) {
+        // Cells of a base grid are stored directly, so the index arithmetic can be inlined
+        withIndexing([&iterateOverChunks](const auto &indexing) {
+          iterateOverChunks([&indexing](int x, int y, int z) { return indexing.getIndex(x, y, z); });
+        });
+      } else {
+        iterateOverChunks([this](int x, int y, int z) {
+          return this->getIndexFromCoordinate(Coordinate<int>(x, y, z));
+        });
       }
-
-
     }
 
   protected:
@@ -381,7 +440,7 @@ namespace grids {
         Used by super-sampled virtual grids to return flags stored at lower resolution, and by
         sub-sampled virtual grids to flag cells stored at a higher resolution.
     */
-    static void upscaleCellFlagVector(const std::vector<size_t> sourceArray,
+    static void upscaleCellFlagVector(const std::vector<size_t> &sourceArray,
                                       std::vector<size_t> &targetArray,
                                       const Grid<T> *source,
                                       const Grid<T> *target) {
@@ -389,18 +448,27 @@ namespace grids {
       assert(target->size >= source->size);
       assert((target->size) % (source->size) == 0);
       int factor = int(target->size / source->size);
-      targetArray.clear();
+      size_t factor3 = size_t(factor) * size_t(factor) * size_t(factor);
+      const size_t notContained = std::numeric_limits<size_t>::max();
 
-      for (auto id: sourceArray) {
-        auto coord = source->getCoordinateFromIndex(id);
+      // Each source cell owns a fixed block of factor^3 output slots, so that the cells can be processed in parallel
+      // while retaining the same output order as a serial loop. Slots outside the target are then squeezed out.
+      targetArray.resize(sourceArray.size() * factor3);
+
+#pragma omp parallel for
+      for (size_t i = 0; i < sourceArray.size(); ++i) {
+        auto coord = source->getCoordinateFromIndex(sourceArray[i]);
+        size_t slot = i * factor3;
         iterateOverCube<int>(
           coord * factor, coord * factor + factor,
-          [&targetArray, &target](const Coordinate<int> &subCoord) {
-            if(target->containsCellWithCoordinate(subCoord))
-              targetArray.push_back(target->getIndexFromCoordinateNoWrap(subCoord));
+          [&targetArray, &target, &slot, notContained](const Coordinate<int> &subCoord) {
+            targetArray[slot++] = target->containsCellWithCoordinate(subCoord) ?
+                                  target->getIndexFromCoordinateNoWrap(subCoord) : notContained;
           }
         );
       }
+
+      targetArray.erase(std::remove(targetArray.begin(), targetArray.end(), notContained), targetArray.end());
     }
 
     /*! \brief Converts flags from a high resolution grid to flags in a low resolution grid.
@@ -408,7 +476,7 @@ namespace grids {
     Used by sub-sampled virtual grids to return flags stored at higher resolution, and by
     super-sampled virtual grids to flag cells stored at a lower resolution.
     */
-    static void downscaleCellFlagVector(const std::vector<size_t> sourceArray,
+    static void downscaleCellFlagVector(const std::vector<size_t> &sourceArray,
                                         std::vector<size_t> &targetArray,
                                         const Grid<T> *source,
                                         const Grid<T> *target) {
@@ -430,9 +498,7 @@ namespace grids {
         targetArray[i] = target->getIndexFromCoordinateNoWrap(coord / factor);
       }
 
-      // this sort seems to be the slowest step. In C++17 we can make it parallel... or is there a
-      // better overall algorithm?
-      tools::sortAndEraseDuplicate(targetArray);
+      sortAndEraseDuplicateCells(targetArray, target->size3);
     }
 
 
@@ -468,29 +534,109 @@ namespace grids {
         throw std::runtime_error("Cannot calculate the center of an empty region");
       }
 
-      T runningx = 0.0;
-      T runningy = 0.0;
-      T runningz = 0.0;
+      // Cell centroids are separable in x, y and z, so it suffices to count how many of the cells lie at each
+      // coordinate along each axis; the wrapped offsets then only need evaluating once per coordinate.
+      std::vector<size_t> countsAlongAxis[3];
+      for (auto &counts : countsAlongAxis)
+        counts.resize(size, 0);
+
+#pragma omp parallel
+      {
+        std::vector<size_t> threadCountsAlongAxis[3];
+        for (auto &counts : threadCountsAlongAxis)
+          counts.resize(size, 0);
+
+#pragma omp for
+        for (size_t i = 0; i < vector_ids.size(); i++) {
+          size_t id = vector_ids[i];
+          threadCountsAlongAxis[0][id / size2]++;
+          threadCountsAlongAxis[1][(id / size) % size]++;
+          threadCountsAlongAxis[2][id % size]++;
+        }
+
+#pragma omp critical
+        for (int axis = 0; axis < 3; ++axis)
+          for (size_t c = 0; c < size; ++c)
+            countsAlongAxis[axis][c] += threadCountsAlongAxis[axis][c];
+      }
 
       auto p0_location = this->getCentroidFromIndex(vector_ids[0]);
 
       // Calculate the wrapped mean wrto to cell 0
-      for (size_t i = 1; i < vector_ids.size(); i++) {
-        size_t id = vector_ids[i];
-        auto pi_location = this->getCentroidFromIndex(id);
-        runningx += this->getWrappedOffset(pi_location.x, p0_location.x);
-        runningy += this->getWrappedOffset(pi_location.y, p0_location.y);
-        runningz += this->getWrappedOffset(pi_location.z, p0_location.z);
+      Coordinate<T> running;
+      for (int axis = 0; axis < 3; ++axis) {
+        std::vector<T> centroids = getCentroidComponentsAlongAxis(axis);
+        T p0_component = p0_location[axis];
+        T total = 0.0;
+        for (size_t c = 0; c < size; ++c) {
+          if (countsAlongAxis[axis][c] > 0)
+            total += T(countsAlongAxis[axis][c]) * this->getWrappedOffset(centroids[c], p0_component);
+        }
+        running[axis] = total / vector_ids.size();
       }
-      runningx /= vector_ids.size();
-      runningy /= vector_ids.size();
-      runningz /= vector_ids.size();
 
       // Add back cell 0 and wrap if needed
-      runningx += p0_location.x;
-      runningy += p0_location.y;
-      runningz += p0_location.z;
-      return this->wrapPoint(Coordinate<T>(runningx, runningy, runningz));
+      running += p0_location;
+      return this->wrapPoint(running);
+    }
+
+    /*! \brief Returns, for each integer coordinate along the given axis (0, 1 or 2 for x, y or z), the corresponding
+        component of the cell centroids.
+
+        Relies on the centroid of a cell along one axis depending only on its coordinate along that axis, which is true
+        of all grids including the virtual ones.
+     */
+    std::vector<T> getCentroidComponentsAlongAxis(int axis) const {
+      std::vector<T> result(size);
+      size_t stride = axis == 0 ? size2 : (axis == 1 ? size : 1);
+      for (size_t c = 0; c < size; ++c)
+        result[c] = this->getCentroidFromIndex(c * stride)[axis];
+      return result;
+    }
+
+    /*! \brief Appends to ids the cells whose centroids pass a test on their wrapped offset from a given centre.
+
+        Only cells within halfExtent of the centre along every axis are considered, so the cost is proportional to the
+        volume of the bounding box rather than of the grid. The inclusion function must therefore reject any offset
+        outside the box. Indices are appended in ascending order.
+
+        \param centre - the centre of the region, in Mpc/h
+        \param halfExtent - half the side length of the region's bounding box along each axis, in Mpc/h
+        \param inclusionFunction - returns true if a cell with the given wrapped offset from the centre is in the region
+        \param ids - vector to which the selected cell indices are appended
+     */
+    void appendIdsInRegion(const Coordinate<T> &centre, const Coordinate<T> &halfExtent,
+                           const std::function<bool(T, T, T)> &inclusionFunction, std::vector<size_t> &ids) const {
+      // For each axis, find the coordinates lying within the bounding box once periodic wrapping is accounted for.
+      // The box is padded by a fraction of a cell so that rounding can never exclude a cell the inclusion test accepts.
+      std::vector<size_t> candidates[3];
+      std::vector<T> offsets[3];
+      for (int axis = 0; axis < 3; ++axis) {
+        std::vector<T> centroids = getCentroidComponentsAlongAxis(axis);
+        for (size_t c = 0; c < size; ++c) {
+          T delta = this->getWrappedOffset(centroids[c], centre[axis]);
+          if (std::abs(delta) <= halfExtent[axis] + cellSize / 4) {
+            candidates[axis].push_back(c);
+            offsets[axis].push_back(delta);
+          }
+        }
+      }
+
+      size_t nx = candidates[0].size();
+      std::vector<std::vector<size_t>> idsForEachX(nx);
+
+#pragma omp parallel for schedule(dynamic)
+      for (size_t i = 0; i < nx; ++i) {
+        for (size_t j = 0; j < candidates[1].size(); ++j) {
+          for (size_t k = 0; k < candidates[2].size(); ++k) {
+            if (inclusionFunction(offsets[0][i], offsets[1][j], offsets[2][k]))
+              idsForEachX[i].push_back((candidates[0][i] * size + candidates[1][j]) * size + candidates[2][k]);
+          }
+        }
+      }
+
+      for (auto &idsThisX : idsForEachX)
+        ids.insert(ids.end(), idsThisX.begin(), idsThisX.end());
     }
 
     //! True if point in physical coordinates is on this grid
@@ -611,21 +757,49 @@ namespace grids {
 
     //! Returns cell id in pixel coordinates
     virtual Coordinate<int> getCoordinateFromIndex(size_t id) const {
-      size_t x, y;
-
       if ((unsigned) id >= size3) {
         throw std::runtime_error("Index out of range");
       }
 
-      // The following implementation is a little faster than using the
-      // modulo operator.
-      x = id / size2;
-      id -= x * size2;
-      y = id / size;
-      id -= y * size;
+      if (sizeIsPowerOfTwo)
+        return powerOfTwoIndexing.getCoordinate(id);
+      else
+        return generalIndexing.getCoordinate(id);
+    }
+
+    /*! \brief Call the callback with the index arithmetic for this grid's size, i.e. a GeneralIndexing or, if the size
+        is a power of two, a PowerOfTwoIndexing.
 
-      auto coord = Coordinate<int>(int(x), int(y), int(id));
-      return coord;
+        Kernels should dispatch here once, outside their loop over cells, taking the indexing as a generic lambda
+        parameter so that the loop is compiled separately for each. The indexing describes how cells are stored,
+        so it only applies to virtual grids that index their cells in the same way as a base grid.
+    */
+    template<typename CallbackType>
+    void withIndexing(const CallbackType &callback) const {
+      if (sizeIsPowerOfTwo)
+        callback(powerOfTwoIndexing);
+      else
+        callback(generalIndexing);
+    }
+
+    /*! \brief Call the callback with a function object equivalent to getIndexFromIndexAndStep.
+
+        For a base grid covering the whole periodic domain this inlines the arithmetic from withIndexing; otherwise
+        it falls back to the virtual methods, which know how to remap and wrap cells of virtual or zoomed grids.
+    */
+    template<typename CallbackType>
+    void withIndexFromIndexAndStep(const CallbackType &callback) const {
+      if (typeid(*this) == typeid(Grid<T>) && size == simEquivalentSize) {
+        withIndexing([&callback](const auto &indexing) {
+          callback([&indexing](size_t index, const Coordinate<int> &step) {
+            return indexing.getIndexFromIndexAndStep(index, step);
+          });
+        });
+      } else {
+        callback([this](size_t index, const Coordinate<int> &step) {
+          return this->getIndexFromIndexAndStep(index, step);
+        });
+      }
     }
 
     /*! \brief Returns coordinate of centre of cell id, in physical box coordinates
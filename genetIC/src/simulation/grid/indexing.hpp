@@ -0,0 +1,96 @@
+#ifndef IC_INDEXING_HPP
+#define IC_INDEXING_HPP
+
+#include <cstddef>
+#include "src/simulation/coordinate.hpp"
+
+namespace grids {
+
+  //! Returns true if n is a power of two
+  inline bool isPowerOfTwo(size_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+  }
+
+  /*! \class GeneralIndexing
+      \brief Index arithmetic for a cube of cells stored as (x*size+y)*size+z, for any size.
+
+      GeneralIndexing and PowerOfTwoIndexing have the same interface, so that kernels can be written once as templates
+      and instantiated for each. Use Grid::withIndexing to choose between them once, outside the loop over cells.
+  */
+  class GeneralIndexing {
+  protected:
+    size_t size; //!< Number of cells along each side
+    size_t size2; //!< Number of cells on each face
+
+  public:
+    explicit GeneralIndexing(size_t size) : size(size), size2(size * size) {}
+
+    //! Index of the cell at the given coordinate, which must lie within the cube
+    size_t getIndex(int x, int y, int z) const {
+      return (size_t(x) * size + size_t(y)) * size + size_t(z);
+    }
+
+    //! Coordinate of the cell with the given index
+    Coordinate<int> getCoordinate(size_t index) const {
+      size_t x = index / size2;
+      index -= x * size2;
+      size_t y = index / size;
+      index -= y * size;
+      return Coordinate<int>(int(x), int(y), int(index));
+    }
+
+    //! Wrap one component of a coordinate periodically into [0, size)
+    int wrap(int component) const {
+      int wrapped = component % int(size);
+      return wrapped < 0 ? wrapped + int(size) : wrapped;
+    }
+
+    //! Index of the cell displaced from the given one by step, wrapping periodically
+    size_t getIndexFromIndexAndStep(size_t index, const Coordinate<int> &step) const {
+      auto coord = getCoordinate(index);
+      return getIndex(wrap(coord.x + step.x), wrap(coord.y + step.y), wrap(coord.z + step.z));
+    }
+  };
+
+  /*! \class PowerOfTwoIndexing
+      \brief Index arithmetic for a cube of cells stored as (x*size+y)*size+z, where size is a power of two.
+
+      Divisions and modulo operations become shifts and masks. The results are only meaningful if the size really is
+      a power of two.
+  */
+  class PowerOfTwoIndexing {
+  protected:
+    unsigned int shift; //!< log2 of the number of cells along each side
+    size_t mask; //!< Number of cells along each side, minus one
+
+  public:
+    explicit PowerOfTwoIndexing(size_t size) : shift(0), mask(size - 1) {
+      while ((size_t(1) << shift) < size)
+        ++shift;
+    }
+
+    //! Index of the cell at the given coordinate, which must lie within the cube
+    size_t getIndex(int x, int y, int z) const {
+      return (((size_t(x) << shift) | size_t(y)) << shift) | size_t(z);
+    }
+
+    //! Coordinate of the cell with the given index
+    Coordinate<int> getCoordinate(size_t index) const {
+      return Coordinate<int>(int(index >> (2 * shift)), int((index >> shift) & mask), int(index & mask));
+    }
+
+    //! Wrap one component of a coordinate periodically into [0, size)
+    int wrap(int component) const {
+      return int(static_cast<unsigned int>(component) & static_cast<unsigned int>(mask));
+    }
+
+    //! Index of the cell displaced from the given one by step, wrapping periodically
+    size_t getIndexFromIndexAndStep(size_t index, const Coordinate<int> &step) const {
+      auto coord = getCoordinate(index);
+      return getIndex(wrap(coord.x + step.x), wrap(coord.y + step.y), wrap(coord.z + step.z));
+    }
+  };
+
+}
+
+#endif
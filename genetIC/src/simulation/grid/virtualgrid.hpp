@@ -2,6 +2,8 @@
 #define IC_VIRTUALGRID_HPP
 
 #include <cassert>
+#include <algorithm>
+#include <typeinfo>
 #include <set>
 #include <type_traits>
 #include <memory>
@@ -123,7 +125,7 @@ namespace grids {
     Field data is obtained by interpolating the underlying low resolution grid.
   */
   template<typename T>
-  class SuperSampleGrid : public VirtualGrid<T> {
+  class SuperSampleGrid final : public VirtualGrid<T> {
   private:
     int factor; //!< Cells of the SuperSampleGrid are factor times smaller than those of the underlying grid.
     int factor3; //!< SuperSampleGrid has factor3 times as many cells as the underlying grid.
@@ -214,7 +216,7 @@ namespace grids {
     high resolution within the high-res window.
   */
   template<typename T>
-  class ResolutionMatchingGrid : public VirtualGrid<T> {
+  class ResolutionMatchingGrid final : public VirtualGrid<T> {
   protected:
     using typename Grid<T>::GridPtrType;
     using typename Grid<T>::ConstGridPtrType;
@@ -316,6 +318,7 @@ namespace grids {
       this->pUnderlyingLoResInterpolated->getFlaggedCells(interpolatedCellsArray);
       // Map the co-ordinates of the flagged cells from the high resolution region into co-ordinates in the super-sampled low resolution grid
       // and store the relevant indices:
+#pragma omp parallel for
       for (size_t i = 0; i < targetArray.size(); ++i) {
         auto coordinate =
           this->pUnderlyingHiRes->getCoordinateFromIndex(targetArray[i]) + this->windowLowerCornerInclusive;
@@ -332,7 +335,7 @@ namespace grids {
         }
       }
 
-      tools::sortAndEraseDuplicate(targetArray);
+      sortAndEraseDuplicateCells(targetArray, this->size3);
     }
 
     //! Flags all the cells specified in sourceArray as if they were cells in the super-sampled low resolution grid, converting them to flags on the two underlying grids
@@ -408,7 +411,7 @@ namespace grids {
     lie inside the underlying grid too.
   */
   template<typename T>
-  class SectionOfGrid : public VirtualGrid<T> {
+  class SectionOfGrid final : public VirtualGrid<T> {
   private:
     Coordinate<int> cellOffset; //!< Co-ordinates of the lower left front corner of the sub-section (virtual grid) in the underlying grid.
     Coordinate<T> posOffset; //!< Position offset in co-moving co-ordinates of the lower front left corner of the sub-section.
@@ -494,7 +497,7 @@ namespace grids {
         if (this->containsCellWithCoordinate(coord))
           targetArray.push_back(this->getIndexFromCoordinate(coord));
       }
-      tools::sortAndEraseDuplicate(targetArray);
+      sortAndEraseDuplicateCells(targetArray, this->size3);
     }
 
     //! Flags the specified cells (interpreted as indices in the virtual grid) in the underlying grid if they lie inside it.
@@ -507,7 +510,7 @@ namespace grids {
           continue;
         }
       }
-      tools::sortAndEraseDuplicate(underlyingArray);
+      sortAndEraseDuplicateCells(underlyingArray, this->pUnderlying->size3);
       this->pUnderlying->flagCells(underlyingArray);
     }
 
@@ -523,7 +526,7 @@ namespace grids {
   Field data is accessed by coarse graining the field on the underlying grid.
   */
   template<typename T>
-  class SubSampleGrid : public VirtualGrid<T> {
+  class SubSampleGrid final : public VirtualGrid<T> {
   private:
     int factor; //!< Resolution is factor times lower than underlying grid
     int factor3; //!< Virtual grid contains factor3 times fewer points than the underlying grid
@@ -573,7 +576,8 @@ namespace grids {
         \param id - cell in the virtual grid. Operation is applied to all cells in the underlying grid that are mapped to this by downscaling.
         \param callback - function to be applied to each of the sub-cells on the underlying grid.
     */
-    int forEachSubcell(size_t id, std::function<void(size_t)> callback) const {
+    template<typename CallbackType>
+    int forEachSubcell(size_t id, const CallbackType &callback) const {
       auto coord0 = this->getCoordinateFromIndex(id);
       coord0 *= factor;
       auto coord1 = coord0 + factor;
@@ -608,6 +612,44 @@ namespace grids {
       return localFactor3;
     }
 
+    /*! \brief Average values stored on the underlying grid over the sub-cells of a run of cells along a row of this grid
+
+        The sums are taken in the same order as with forEachSubcell, so the results are identical to averaging cell by
+        cell, but the underlying values are read contiguously instead of through a callback per sub-cell.
+        The underlying grid must be a base grid, so that its cells are stored contiguously.
+
+        \param underlyingData - values on the underlying grid, indexed as for its cells
+        \param row - the row of cells on this grid, i.e. x*size+y
+        \param zBegin - first cell along the row to average
+        \param zEnd - one past the last cell along the row to average
+        \param averaged - zEnd-zBegin values, to be overwritten
+    */
+    template<typename DataType>
+    void averageSubcellsAlongRow(const DataType *underlyingData, size_t row, size_t zBegin, size_t zEnd,
+                                 DataType *averaged) const {
+      assert(typeid(*this->pUnderlying) == typeid(Grid<T>));
+      const size_t underlyingSize = this->pUnderlying->size, n = this->size, f = size_t(factor);
+      const size_t x0 = (row / n) * f, y0 = (row % n) * f;
+      const size_t x1 = std::min(x0 + f, underlyingSize), y1 = std::min(y0 + f, underlyingSize);
+
+      std::fill(averaged, averaged + (zEnd - zBegin), DataType(0));
+      for (size_t xi = x0; xi < x1; ++xi) {
+        for (size_t yi = y0; yi < y1; ++yi) {
+          const DataType *underlyingRow = underlyingData + (xi * underlyingSize + yi) * underlyingSize;
+          for (size_t z = zBegin; z < zEnd; ++z) {
+            const size_t z1 = std::min((z + 1) * f, underlyingSize);
+            for (size_t zi = z * f; zi < z1; ++zi)
+              averaged[z - zBegin] += underlyingRow[zi];
+          }
+        }
+      }
+
+      for (size_t z = zBegin; z < zEnd; ++z) {
+        const size_t nz = std::min((z + 1) * f, underlyingSize) - z * f;
+        averaged[z - zBegin] = averaged[z - zBegin] / T((x1 - x0) * (y1 - y0) * nz);
+      }
+    }
+
     GridPtrType makeSupersampled(size_t ratio) const override {
       // Special case: supersampling a subsampled grid can needlessly destroy accuracy, so avoid it!
       if (ratio > factor) {
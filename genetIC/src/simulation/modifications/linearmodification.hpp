@@ -77,7 +77,7 @@ namespace modifications {
     //! Returns a covector for the specified grid defined such that a.f returns the average of field f over the flagged points on the grid.
     virtual fields::Field<DataType, T> calculateLocalisationCovector(const grids::Grid<T> &grid) {
       fields::Field<DataType, T> outputField = fields::Field<DataType, T>(grid, false);
-      std::vector<DataType> &outputData = outputField.getDataVector();
+      auto &outputData = outputField.getDataVector();
 
       T w = 1.0 / this->flaggedCellsFinestGrid.size();
 
@@ -211,7 +211,7 @@ namespace modifications {
         negDirectionVector[direction] = -1;
 
         fields::Field<DataType, T> outputField = fields::Field<DataType, T>(grid, false);
-        std::vector<DataType> &outputData = outputField.getDataVector();
+        auto &outputData = outputField.getDataVector();
 
         T w = 1.0 / this->flaggedCellsFinestGrid.size();
 
@@ -220,17 +220,19 @@ namespace modifications {
         // Coeffs for the finite difference.  The signs here so that result is - Nabla Phi
         T a = -w / 12. / grid.cellSize, b = w * 2. / 3. / grid.cellSize;
 
-        for (size_t i = 0; i < this->flaggedCellsFinestGrid.size(); i++) {
-          size_t index = this->flaggedCellsFinestGrid[i];
-          ind_m1 = grid.getIndexFromIndexAndStep(index, negDirectionVector);
-          ind_p1 = grid.getIndexFromIndexAndStep(index, directionVector);
-          ind_m2 = grid.getIndexFromIndexAndStep(ind_m1, negDirectionVector);
-          ind_p2 = grid.getIndexFromIndexAndStep(ind_p1, directionVector);
-          outputData[ind_m2] += a;
-          outputData[ind_m1] += b;
-          outputData[ind_p1] -= b;
-          outputData[ind_p2] -= a;
-        }
+        grid.withIndexFromIndexAndStep([&](const auto &getIndexFromIndexAndStep) {
+          for (size_t i = 0; i < this->flaggedCellsFinestGrid.size(); i++) {
+            size_t index = this->flaggedCellsFinestGrid[i];
+            ind_m1 = getIndexFromIndexAndStep(index, negDirectionVector);
+            ind_p1 = getIndexFromIndexAndStep(index, directionVector);
+            ind_m2 = getIndexFromIndexAndStep(ind_m1, negDirectionVector);
+            ind_p2 = getIndexFromIndexAndStep(ind_p1, directionVector);
+            outputData[ind_m2] += a;
+            outputData[ind_m1] += b;
+            outputData[ind_p1] -= b;
+            outputData[ind_p2] -= a;
+          }
+        });
 
         outputField.toFourier();
         return outputField;
@@ -340,42 +342,44 @@ namespace modifications {
           dirp2 = (direction + 2) % 3;
 
       fields::Field<DataType, T> outputField = fields::Field<DataType, T>(grid, false);
-      std::vector<DataType> &outputData = outputField.getDataVector();
-
-      for (size_t i = 0; i < this->flaggedCellsFinestGrid.size(); ++i) {
-        size_t index = this->flaggedCellsFinestGrid[i];
-        Coordinate<T> q = grid.getCentroidFromIndex(index);
-
-        Coordinate<T> deltaq = grid.getWrappedOffset(qcenter, q);
-
-        Coordinate<T> qCrossCoeff;
-        // Coefficient to compute cross product (this is the "q \cross" part of q \cross v)
-        qCrossCoeff[direction] = 0;
-        qCrossCoeff[dirp2] =  deltaq[dirp1];  // lx \propto qy * vz
-        qCrossCoeff[dirp1] = -deltaq[dirp2];  //                    - qz * vy
-
-        // Create gradient + cross product covector by combining gradient operator with cross product
-        // to yield -q \cross \nabla · operator (using 4-th order finite-difference)
-        for (int dir = 0; dir < 3; ++dir) {
-          if (dir != direction) { // Not necessary, but saves one iteration
-            size_t ind_p1, ind_m1, ind_p2, ind_m2;
-            Coordinate<int> directionVector;
-            Coordinate<int> negDirectionVector;
-
-            directionVector[dir] = 1;
-            negDirectionVector[dir] = -1;
-
-            ind_m1 = grid.getIndexFromIndexAndStep(index, negDirectionVector);
-            ind_m2 = grid.getIndexFromIndexAndStep(ind_m1, negDirectionVector);
-            ind_p1 = grid.getIndexFromIndexAndStep(index, directionVector);
-            ind_p2 = grid.getIndexFromIndexAndStep(ind_p1, directionVector);
-            outputData[ind_m2] += qCrossCoeff[dir] * a;
-            outputData[ind_m1] += qCrossCoeff[dir] * b;
-            outputData[ind_p1] -= qCrossCoeff[dir] * b;
-            outputData[ind_p2] -= qCrossCoeff[dir] * a;
+      auto &outputData = outputField.getDataVector();
+
+      grid.withIndexFromIndexAndStep([&](const auto &getIndexFromIndexAndStep) {
+        for (size_t i = 0; i < this->flaggedCellsFinestGrid.size(); ++i) {
+          size_t index = this->flaggedCellsFinestGrid[i];
+          Coordinate<T> q = grid.getCentroidFromIndex(index);
+
+          Coordinate<T> deltaq = grid.getWrappedOffset(qcenter, q);
+
+          Coordinate<T> qCrossCoeff;
+          // Coefficient to compute cross product (this is the "q \cross" part of q \cross v)
+          qCrossCoeff[direction] = 0;
+          qCrossCoeff[dirp2] =  deltaq[dirp1];  // lx \propto qy * vz
+          qCrossCoeff[dirp1] = -deltaq[dirp2];  //                    - qz * vy
+
+          // Create gradient + cross product covector by combining gradient operator with cross product
+          // to yield -q \cross \nabla · operator (using 4-th order finite-difference)
+          for (int dir = 0; dir < 3; ++dir) {
+            if (dir != direction) { // Not necessary, but saves one iteration
+              size_t ind_p1, ind_m1, ind_p2, ind_m2;
+              Coordinate<int> directionVector;
+              Coordinate<int> negDirectionVector;
+
+              directionVector[dir] = 1;
+              negDirectionVector[dir] = -1;
+
+              ind_m1 = getIndexFromIndexAndStep(index, negDirectionVector);
+              ind_m2 = getIndexFromIndexAndStep(ind_m1, negDirectionVector);
+              ind_p1 = getIndexFromIndexAndStep(index, directionVector);
+              ind_p2 = getIndexFromIndexAndStep(ind_p1, directionVector);
+              outputData[ind_m2] += qCrossCoeff[dir] * a;
+              outputData[ind_m1] += qCrossCoeff[dir] * b;
+              outputData[ind_p1] -= qCrossCoeff[dir] * b;
+              outputData[ind_p2] -= qCrossCoeff[dir] * a;
+            }
           }
         }
-      }
+      });
 
       outputField.toFourier();
 
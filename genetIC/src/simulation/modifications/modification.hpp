@@ -60,6 +60,11 @@ namespace modifications {
       target = target_;
     }
 
+    //! Returns the cells on each level that were flagged when the modification was defined
+    const std::vector<std::vector<size_t>> &getFlaggedCells() const {
+      return flaggedCells;
+    }
+
     //! Returns 1 for linear modifications, and 2 for quadratic modifications (and n for nth order modifications if these were created)
     unsigned int getOrder() {
       return this->order;
@@ -54,9 +54,10 @@ namespace modifications {
         \param name_ - String naming the modification required.
         \param type_ - Modification can be relative to existing value or absolute.
         \param target_ - Absolute target or factor by which the existing will be multiplied.
+        \return The modification that was added, with its target converted to an absolute value
       */
     template<typename ... Args>
-    void addModificationToList(std::string name_, std::string type_, T target_, Args &&... args) {
+    std::shared_ptr<Modification<DataType, T>> addModificationToList(std::string name_, std::string type_, T target_, Args &&... args) {
 
       std::shared_ptr<Modification<DataType, T>> modification = getModificationFromName(name_,
                                                                                         std::forward<Args>(args)...);
@@ -79,6 +80,7 @@ namespace modifications {
       } else {
         throw std::runtime_error(" Could not add modification to list");
       }
+      return modification;
     }
 
     //! Returns true if modifications have been added to the list
@@ -125,6 +127,17 @@ namespace modifications {
     }
 
 
+    //! Returns true if the supplied string is "relative", false if "absolute", and an error if anything else.
+    bool isRelative(std::string type) {
+      bool relative = false;
+      if (strcasecmp(type.c_str(), "relative") == 0) {
+        relative = true;
+      } else if (strcasecmp(type.c_str(), "absolute") != 0) {
+        throw std::runtime_error("Modification type must be either 'relative' or 'absolute'");
+      }
+      return relative;
+    }
+
     //! Clear all modifications from the list of modifications to be applied.
     void clearModifications() {
       logging::entry() << "Clearing modification list" << std::endl;
@@ -330,17 +343,6 @@ namespace modifications {
       (*alpha) /= norm;
     }
 
-    //! Returns true if the supplied string is "relative", false if "absolute", and an error if anything else.
-    bool isRelative(std::string type) {
-      bool relative = false;
-      if (strcasecmp(type.c_str(), "relative") == 0) {
-        relative = true;
-      } else if (strcasecmp(type.c_str(), "absolute") != 0) {
-        throw std::runtime_error("Modification type must be either 'relative' or 'absolute'");
-      }
-      return relative;
-    }
-
     //! Calculates delta chi2 from orthonormalised linear modifications (Eq 12 Roth et al 2016)
     T getDeltaChi2FromLinearModifs(fields::OutputField<DataType> &field,
                                    std::vector<std::shared_ptr<fields::ConstraintField<DataType>>> alphas,
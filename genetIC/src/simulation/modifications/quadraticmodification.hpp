@@ -175,7 +175,7 @@ namespace modifications {
 
       assert(!field.isFourier()); // Windowing is done in real space
 
-      std::vector<DataType> &fieldData = field.getDataVector();
+      auto &fieldData = field.getDataVector();
 
 #pragma omp parallel for schedule(static) default(none) shared(fieldData, level)
       for (size_t i = 0; i < fieldData.size(); ++i) {
@@ -205,7 +205,7 @@ namespace modifications {
 
       windowOperator(field, level);
 
-      std::vector<DataType> &fieldData = field.getDataVector();
+      auto &fieldData = field.getDataVector();
       size_t regionSize = this->flaggedCells[level].size();
 
       // Calculate mean value in flagged region
@@ -79,8 +79,9 @@ namespace multilevelgrid {
 
     virtual ~MultiLevelGridBase() {}
 
-    void setLevelsAreCombined() {
-      levelsAreCombined = true;
+    //! Record whether low-frequency information has been propagated into the high-resolution fields
+    void setLevelsAreCombined(bool combined = true) {
+      levelsAreCombined = combined;
     }
 
     bool getLevelsAreCombined() const {
@@ -78,6 +78,9 @@ namespace particle {
     //! Recalculates the position and velocity offsets for particles on this grid
     virtual void recalculate() = 0;
 
+    //! Flips the sign of the position and velocity offsets, as if they had been calculated from the reversed field
+    virtual void reverse() = 0;
+
     //! Returns a vector of the fields required to generate position and velocity offsets
     virtual std::vector<std::shared_ptr<fields::Field<GT>>> getGeneratedFields() = 0;
 
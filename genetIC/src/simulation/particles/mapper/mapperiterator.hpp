@@ -202,7 +202,12 @@ namespace particle {
         return pMapper->size() - getIndex();
       }
 
-      //! Iterates in parallel, applying the callback function
+      /*! \brief Iterates in parallel, applying the callback function
+       *
+       * Threads take runs of consecutive particles in turn, rather than single particles, so that each thread works
+       * through a spatially coherent region. This lets evaluators that share work between neighbouring particles
+       * (e.g. the row-by-row interpolation onto supersampled grids) reuse it.
+       */
       size_t parallelIterate(std::function<void(size_t, const MapperIterator &)> callback, size_t nMax) {
         if (pMapper == nullptr) return 0;
 
@@ -211,6 +216,12 @@ namespace particle {
 
         if (n == 0) return 0;
 
+#ifdef _OPENMP
+        size_t runLength = std::max(size_t(1), std::min(size_t(4096), n / (4 * size_t(omp_get_max_threads()))));
+#else
+        size_t runLength = n;
+#endif
+
 #pragma omp parallel
         {
           MapperIterator *pThreadLocalIterator;
@@ -228,12 +239,21 @@ namespace particle {
             pThreadLocalIterator = new MapperIterator(*this);
 
 #pragma omp barrier
-          if ((unsigned) thread_num < n) {
-            (*pThreadLocalIterator) += thread_num;
-
-            for (size_t local_i = thread_num; local_i < n; local_i += num_threads) {
-              callback(local_i, *pThreadLocalIterator);
-              if (local_i + num_threads < n) (*pThreadLocalIterator) += num_threads;
+          size_t runStart = thread_num * runLength;
+          if (runStart < n) {
+            (*pThreadLocalIterator) += runStart;
+
+            while (true) {
+              size_t runEnd = std::min(runStart + runLength, n);
+              for (size_t local_i = runStart; local_i < runEnd; ++local_i) {
+                callback(local_i, *pThreadLocalIterator);
+                if (local_i + 1 < runEnd) ++(*pThreadLocalIterator);
+              }
+
+              size_t nextRunStart = runStart + num_threads * runLength;
+              if (nextRunStart >= n) break;
+              (*pThreadLocalIterator) += nextRunStart - (runEnd - 1);
+              runStart = nextRunStart;
             }
           }
 
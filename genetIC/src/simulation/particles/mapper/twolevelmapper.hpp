@@ -290,50 +290,58 @@ namespace particle {
       //! Flags the particles specified by orderedParticleIndices. Flags the level 1 particles first, and then the level 2 particles that lie in the high-res region
       void flagParticles(const std::vector<size_t> &orderedParticleIndices) override {
 
-        std::vector<size_t> level1particles;
-
         if (pLevel1->size() < level1ParticlesToReplace.size())
           throw std::runtime_error("Zoom particle list is longer than the grid it refers to");
 
+        if (!std::is_sorted(orderedParticleIndices.begin(), orderedParticleIndices.end()))
+          throw std::runtime_error("The particle list must be in ascending order");
+
         size_t firstHiresParticleInMapper = pLevel1->size() - level1ParticlesToReplace.size();
+        size_t nZoomParticles = level1ParticlesToReplace.size();
 
+        // The low-res particles come first in the input; everything from here onwards is high-res
+        size_t firstHrParticleInInput = std::lower_bound(orderedParticleIndices.begin(), orderedParticleIndices.end(),
+                                                         firstHiresParticleInMapper) - orderedParticleIndices.begin();
 
-        size_t last_val = 0;
-        size_t numSkippedParticlesLR = 0;
-        size_t nZoomParticles = level1ParticlesToReplace.size();
-        size_t firstHrParticleInInput = std::numeric_limits<size_t>::max();
+        std::vector<size_t> level1particles(firstHrParticleInInput);
 
+        // For particles in the low res region, we need to count how many zoomed particles are skipped before
+        // each one to work out its address in the original file ordering. This count is the number of entries k
+        // in the (ascending) zoomed particle list with level1ParticlesToReplace[k] <= thisParticle + k, which
+        // form a prefix of the list. Each thread finds it by bisection for its first particle, then steps it
+        // forward as the (ascending) input particles increase.
+#ifdef OPENMP
+#pragma omp parallel
+#endif
+        {
+          size_t numSkippedParticlesLR = std::numeric_limits<size_t>::max();
 
-        for (size_t i = 0; i < orderedParticleIndices.size(); ++i) {
-          size_t thisParticle = orderedParticleIndices[i];
-          if (thisParticle < last_val)
-            throw std::runtime_error("The particle list must be in ascending order");
-          last_val = (thisParticle);
+#ifdef OPENMP
+#pragma omp for schedule(static)
+#endif
+          for (size_t i = 0; i < firstHrParticleInInput; ++i) {
+            size_t thisParticle = orderedParticleIndices[i];
+
+            if (numSkippedParticlesLR == std::numeric_limits<size_t>::max()) {
+              size_t lower = 0, upper = nZoomParticles;
+              while (lower < upper) {
+                size_t mid = (lower + upper) / 2;
+                if (level1ParticlesToReplace[mid] <= thisParticle + mid)
+                  lower = mid + 1;
+                else
+                  upper = mid;
+              }
+              numSkippedParticlesLR = lower;
+            }
 
-          if (thisParticle < firstHiresParticleInMapper) {
-            // particle in low res region. We need to count how many skipped
-            // particles there are to work out the address in the original
-            // file ordering. NB this approach assumes the input particle array is
-            // in ascending order (and the zoomParticleArray).
             while (numSkippedParticlesLR < nZoomParticles &&
                    level1ParticlesToReplace[numSkippedParticlesLR] <= thisParticle + numSkippedParticlesLR)
               ++numSkippedParticlesLR;
 
-            level1particles.push_back(thisParticle + numSkippedParticlesLR);
-
-          } else {
-            // particle in high res region. This is now handled by the separate loop below.
-            // The loop for high-res particles is parallelised (unlike the low-res particles)
-            // because generating the right indices was found to be slow during profiling.
-            firstHrParticleInInput = i;
-            break;
+            level1particles[i] = thisParticle + numSkippedParticlesLR;
           }
         }
 
-        if (firstHrParticleInInput == std::numeric_limits<size_t>::max()) {
-          firstHrParticleInInput = orderedParticleIndices.size(); // No HR particles in input
-        }
-
 
         std::vector<size_t> level2particles;
         level2particles.resize(orderedParticleIndices.size() - firstHrParticleInInput);
@@ -393,8 +401,8 @@ namespace particle {
 
         // The divided particle lists will now be passed to the underlying particle mappers,
         // which require the input to be sorted
-        std::sort(level1particles.begin(), level1particles.end());
-        std::sort(level2particles.begin(), level2particles.end());
+        tools::parallelSort(level1particles);
+        tools::parallelSort(level2particles);
 
         // We're done with our list so they might as well steal the data.
         pLevel1->flagParticles(std::move(level1particles));
@@ -33,6 +33,9 @@ namespace particle {
     virtual std::shared_ptr<fields::EvaluatorBase<GridDataType, T>>
     makeOverdensityEvaluatorForGrid(const grids::Grid<T> &grid) = 0;
 
+    //! Flips the sign of the particle offsets on all levels, as if they had been generated from the reversed field
+    virtual void reverse() = 0;
+
     //! Creates a particle evaluator for the specified grid and returns a constant pointer to it
     std::shared_ptr<const particle::ParticleEvaluator<GridDataType>>
     makeParticleEvaluatorForGrid(const grids::Grid<T> &grid) const {
@@ -68,12 +71,65 @@ namespace particle {
       throw std::runtime_error("Attempt to get overdensity before it has been calculated");
     }
 
+    //! Throws an error, because we can't reverse particles before we have defined the generator
+    void reverse() override {
+      throw std::runtime_error("Attempt to reverse particles before they have been calculated");
+    }
+
   };
 
   template<typename A, typename B, typename C>
   class MultiLevelParticleGenerator;
 
 
+  /*! \brief Initialise Zeldovich particle generators a component at a time, keeping the offsets in single precision.
+
+      Each offset component is calculated on every level and recombined with the level below, after which that level's
+      component is compacted to single precision. Only when all three components are done is the overdensity itself
+      recombined, since the offsets must be calculated from the uncombined overdensity. At any time at most two
+      double-precision offset fields are alive (one on each of a pair of adjacent levels), rather than three on every
+      level.
+  */
+  template<typename GridDataType, typename T>
+  void initialiseLeanParticleGenerator(
+    MultiLevelParticleGenerator<GridDataType, ZeldovichParticleGenerator<GridDataType>, T> &generator) {
+    using ZPG=ZeldovichParticleGenerator<GridDataType>;
+    size_t nlevels = generator.context.getNumLevels();
+
+    if (nlevels == 0)
+      throw std::runtime_error("Trying to apply zeldovich approximation, but no grids have been created");
+
+    for (size_t level = 0; level < nlevels; ++level)
+      generator.pGenerators.emplace_back(
+        std::make_shared<ZPG>(generator.overdensityField.getFieldForLevel(level), true));
+
+    if (nlevels >= 2)
+      logging::entry() << "Combining information from different levels..." << endl;
+
+    auto filters = generator.overdensityField.getFilters();
+
+    for (int direction = 0; direction < 3; ++direction) {
+      generator.pGenerators[0]->calculateOffsetField(direction);
+      for (size_t level = 1; level < nlevels; ++level) {
+        generator.pGenerators[level]->calculateOffsetField(direction);
+        generator.pGenerators[level]->combineOffsetFieldAndCompactSource(
+          direction, *generator.pGenerators[level - 1], filters.getHighPassFilterForLevel(level),
+          filters.getLowPassFilterForLevel(level - 1));
+      }
+      generator.pGenerators[nlevels - 1]->compactOffsetField(direction);
+    }
+
+    if (nlevels >= 2) {
+      std::shared_ptr<fields::Field<GridDataType, T>> pScratch;
+      for (size_t level = 1; level < nlevels; ++level) {
+        generator.overdensityField.getFieldForLevel(level).combineWithFieldFromDifferentGrid(
+          generator.overdensityField.getFieldForLevel(level - 1), filters.getHighPassFilterForLevel(level),
+          filters.getLowPassFilterForLevel(level - 1), pScratch);
+      }
+      generator.overdensityField.getContext().setLevelsAreCombined();
+    }
+  }
+
   //! Function to initialise Zeldovich particle generators. Separated from main class due to lack of c++ partial template specialisation
   template<typename GridDataType, typename T>
   void initialiseParticleGeneratorBasedOnTemplate(
@@ -85,6 +141,11 @@ namespace particle {
 
     generator.overdensityField.toFourier();
 
+    if (generator.leanMemory) {
+      initialiseLeanParticleGenerator(generator);
+      return;
+    }
+
     if (nlevels == 0) {
       throw std::runtime_error("Trying to apply zeldovich approximation, but no grids have been created");
     } else if (nlevels == 1) {
@@ -102,20 +163,20 @@ namespace particle {
       auto filters = generator.overdensityField.getFilters();
 
       for (size_t level = 1; level < nlevels; ++level) {
-
-        // remove the low-frequency information from this level
-        generator.overdensityField.getFieldForLevel(level).applyFilter(
-          filters.getHighPassFilterForLevel(level));
-        generator.pGenerators[level]->applyFilter(filters.getHighPassFilterForLevel(level));
-
-        // replace with the low-frequency information from the level below
-        generator.overdensityField.getFieldForLevel(level).addFieldFromDifferentGridWithFilter(
-          generator.overdensityField.getFieldForLevel(level - 1),
-          filters.getLowPassFilterForLevel(level - 1));
-        generator.pGenerators[level]->addFieldFromDifferentGridWithFilter(*generator.pGenerators[level - 1],
-                                                                          filters.getLowPassFilterForLevel(level - 1));
-
-
+        const auto &highPassFilter = filters.getHighPassFilterForLevel(level);
+        const auto &lowPassFilter = filters.getLowPassFilterForLevel(level - 1);
+
+        // A single temporary, shared by the overdensity and the three offset fields, holds the filtered
+        // information from the level below while it is merged in
+        auto &fieldThisLevel = generator.overdensityField.getFieldForLevel(level);
+        std::shared_ptr<fields::Field<GridDataType, T>> pScratch;
+
+        // remove the low-frequency information from this level and replace with the low-frequency information
+        // from the level below
+        fieldThisLevel.combineWithFieldFromDifferentGrid(generator.overdensityField.getFieldForLevel(level - 1),
+                                                         highPassFilter, lowPassFilter, pScratch);
+        generator.pGenerators[level]->combineWithFieldsFromDifferentGrid(*generator.pGenerators[level - 1],
+                                                                        highPassFilter, lowPassFilter, pScratch);
       }
 
       generator.overdensityField.getContext().setLevelsAreCombined();
@@ -132,6 +193,16 @@ namespace particle {
   std::shared_ptr<particle::ParticleEvaluator<GridDataType>> makeParticleEvaluatorBasedOnTemplate(
     MultiLevelParticleGenerator<GridDataType, ZeldovichParticleGenerator<GridDataType>, T> &generator,
     const grids::Grid<T> &grid, T epsNorm = 0.01075) {
+    if (generator.leanMemory) {
+      std::vector<std::shared_ptr<fields::EvaluatorBase<float, T>>> fieldEvaluators;
+      for (auto field : generator.compactOutputFields)
+        fieldEvaluators.emplace_back(fields::makeEvaluatorForLevels<float>(*field, grid));
+      return std::make_shared<ZeldovichParticleEvaluator<GridDataType, T, float>>(fieldEvaluators[0],
+                                                                                   fieldEvaluators[1],
+                                                                                   fieldEvaluators[2], grid,
+                                                                                   generator.cosmoParams, epsNorm);
+    }
+
     auto fieldEvaluators = generator.getOutputFieldEvaluatorsForGrid(grid);
     return std::make_shared<ZeldovichParticleEvaluator<GridDataType>>(fieldEvaluators[0], fieldEvaluators[1],
                                                                       fieldEvaluators[2],
@@ -151,7 +222,9 @@ namespace particle {
     std::vector<std::shared_ptr<TParticleGenerator>> pGenerators; //!< Vector of generators for each level
     const cosmology::CosmologicalParameters<T> &cosmoParams; //!< Cosmological parameters
     std::vector<std::shared_ptr<fields::MultiLevelField<GridDataType>>> outputFields; //!< Fields used to define position and velocity offsets (not overdensities!)
+    std::vector<std::shared_ptr<fields::CompactMultiLevelField<GridDataType>>> compactOutputFields; //!< As outputFields, in lean memory mode
     T epsNorm; //!< Cell softening scale pre-factor
+    const bool leanMemory; //!< If true, the output fields are calculated a component at a time and kept in single precision
 
     //! Initialise the relevant particle generator, and gather the output fields used to define position/velocity offsets
     void initialise() {
@@ -169,6 +242,17 @@ namespace particle {
 
     //! Gathers the output fields used to define position and velocity offsets, storing them in the outputFields vector
     void gatherOutputFields() {
+      if (leanMemory) {
+        for (size_t field = 0; field < 3; ++field) {
+          std::vector<std::shared_ptr<fields::Field<float, T>>> fieldsAcrossLevels;
+          for (size_t level = 0; level < context.getNumLevels(); level++)
+            fieldsAcrossLevels.push_back(pGenerators[level]->getCompactFields()[field]);
+          compactOutputFields.emplace_back(
+            std::make_shared<fields::CompactMultiLevelField<GridDataType>>(context, fieldsAcrossLevels));
+        }
+        return;
+      }
+
       size_t numFields = getNumFields();
       for (size_t field = 0; field < numFields; ++field) {
         std::vector<std::shared_ptr<fields::Field<GridDataType>>> fieldsAcrossLevels;
@@ -196,6 +280,9 @@ namespace particle {
     friend void initialiseParticleGeneratorBasedOnTemplate<>(
       MultiLevelParticleGenerator<GridDataType, TParticleGenerator, T> &generator);
 
+    friend void initialiseLeanParticleGenerator<>(
+      MultiLevelParticleGenerator<GridDataType, TParticleGenerator, T> &generator);
+
     friend std::shared_ptr<particle::ParticleEvaluator<GridDataType>> makeParticleEvaluatorBasedOnTemplate<>(
       MultiLevelParticleGenerator<GridDataType, TParticleGenerator, T> &generator,
       const grids::Grid<T> &grid, T epsNorm
@@ -208,12 +295,15 @@ namespace particle {
         \param field - overdensity field needed to define particles.
         \param params - cosmological parameters.
         \param epsNorm_ - pre-factor for cell softening scale
+        \param leanMemory_ - if true, calculate the offsets a component at a time and store them in single precision
     */
     MultiLevelParticleGenerator(fields::OutputField<GridDataType> &field,
-                                const cosmology::CosmologicalParameters<T> &params, T epsNorm_ = 0.01075) :
+                                const cosmology::CosmologicalParameters<T> &params, T epsNorm_ = 0.01075,
+                                bool leanMemory_ = false) :
       overdensityField(field),
       context(field.getContext()),
-      cosmoParams(params) {
+      cosmoParams(params),
+      leanMemory(leanMemory_) {
       initialise();
       epsNorm = epsNorm_;
     }
@@ -235,6 +325,12 @@ namespace particle {
       return fields::makeEvaluator(overdensityField, grid);
     }
 
+    //! Flips the sign of the offsets on each level. The overdensity field belongs to the caller, which must reverse it.
+    void reverse() override {
+      for (auto &pGenerator : pGenerators)
+        pGenerator->reverse();
+    }
+
 
   };
 
@@ -103,6 +103,11 @@ namespace particle {
       return underlying->makeOverdensityEvaluatorForGrid(grid);
     }
 
+    //! Reverses the underlying particle offsets; the constant offsets added here are unchanged
+    void reverse() override {
+      underlying->reverse();
+    }
+
   };
 }
 
@@ -9,7 +9,9 @@
 #include <src/io/numpy.hpp>
 #include "src/tools/progress/progress.hpp"
 #include "src/simulation/field/field.hpp"
+#include "src/simulation/field/evaluator.hpp"
 #include "src/simulation/particles/generator.hpp"
+#include "src/tools/numerics/finitedifference.hpp"
 
 namespace cosmology {
   template<typename T>
@@ -26,16 +28,23 @@ namespace particle {
 
   /*! \class ZeldovichParticleEvaluator
       \brief Class to evaluate particles on a grid using the Zeldovich method
+
+      The offsets may be stored in a different type to the grid data (OffsetType), as they are in lean memory mode.
   */
-  template<typename GridDataType, typename T=tools::datatypes::strip_complex<GridDataType>>
+  template<typename GridDataType, typename T=tools::datatypes::strip_complex<GridDataType>,
+    typename OffsetType=GridDataType>
   class ZeldovichParticleEvaluator : public ParticleEvaluator<GridDataType> {
   protected:
-    using EvaluatorType = std::shared_ptr<fields::EvaluatorBase<GridDataType, T>>;
+    using EvaluatorType = std::shared_ptr<fields::EvaluatorBase<OffsetType, T>>;
     using GridType = grids::Grid<T>;
     using TField = fields::Field<GridDataType, T>;
     EvaluatorType pOffsetXEvaluator; //!< Evaluator for the x offsets
     EvaluatorType pOffsetYEvaluator; //!< Evaluator for the y offsets
     EvaluatorType pOffsetZEvaluator; //!< Evaluator for the z offsets
+#ifdef CUBIC_INTERPOLATION
+    //! If the grid is supersampled, interpolates all three offsets together a row at a time (otherwise nullptr)
+    std::shared_ptr<const fields::SuperSampleRowInterpolator<OffsetType, T>> pOffsetRowInterpolator;
+#endif
 
     const cosmology::CosmologicalParameters<T> &cosmology; //!< Cosmological parameters
 
@@ -77,6 +86,9 @@ namespace particle {
       pOffsetXEvaluator = evalOffX;
       pOffsetYEvaluator = evalOffY;
       pOffsetZEvaluator = evalOffZ;
+#ifdef CUBIC_INTERPOLATION
+      pOffsetRowInterpolator = fields::makeSuperSampleRowInterpolator<OffsetType, T>({evalOffX, evalOffY, evalOffZ});
+#endif
       onGrid = grid.shared_from_this();
       calculateSimulationMass();
       calculateVelocityToOffsetRatio();
@@ -88,9 +100,20 @@ namespace particle {
 
       particle::Particle<T> particle;
 
-      particle.pos.x = tools::datatypes::real_part_if_complex((*pOffsetXEvaluator)[id]);
-      particle.pos.y = tools::datatypes::real_part_if_complex((*pOffsetYEvaluator)[id]);
-      particle.pos.z = tools::datatypes::real_part_if_complex((*pOffsetZEvaluator)[id]);
+#ifdef CUBIC_INTERPOLATION
+      if (pOffsetRowInterpolator != nullptr) {
+        typename fields::SuperSampleRowInterpolator<OffsetType, T>::ResultType offsets[3];
+        pOffsetRowInterpolator->evaluate(id, offsets);
+        particle.pos.x = tools::datatypes::real_part_if_complex(offsets[0]);
+        particle.pos.y = tools::datatypes::real_part_if_complex(offsets[1]);
+        particle.pos.z = tools::datatypes::real_part_if_complex(offsets[2]);
+      } else
+#endif
+      {
+        particle.pos.x = tools::datatypes::real_part_if_complex((*pOffsetXEvaluator)[id]);
+        particle.pos.y = tools::datatypes::real_part_if_complex((*pOffsetYEvaluator)[id]);
+        particle.pos.z = tools::datatypes::real_part_if_complex((*pOffsetZEvaluator)[id]);
+      }
 
       particle.vel = particle.pos * velocityToOffsetRatio;
 
@@ -123,18 +146,25 @@ namespace particle {
 
   /*! \class ZeldovichParticleGenerator
       \brief Class to generate particles using the Zeldovich approximation
+
+      In lean memory mode, nothing is calculated on construction. Instead the caller works through the offset
+      components one at a time (calculateOffsetField, then combineOffsetFieldAndCompactSource on the next level up, or
+      compactOffsetField on the finest level), so that only one double-precision component per level is alive at once and the finished
+      offsets are kept in single precision. See initialiseParticleGeneratorBasedOnTemplate.
   */
   template<typename GridDataType, typename T>
   class ZeldovichParticleGenerator : public ParticleGenerator<GridDataType> {
   protected:
     using TField = fields::Field<GridDataType, T>;
     using TRealField = fields::Field<T, T>;
+    using TCompactField = fields::Field<float, T>;
 
     friend class ZeldovichParticleEvaluator<GridDataType, T>;
 
     TField &linearOverdensityField; //!< Overdensity field used to generate particles on this grid
     using ParticleGenerator<GridDataType>::grid;
 
+    const bool leanMemory; //!< If true, offsets are calculated a component at a time and stored in single precision
 
     // The grid offsets after Zeldovich approximation is applied
     // (nullptr before that):
@@ -142,46 +172,51 @@ namespace particle {
     std::shared_ptr<TField> pOff_y; //!< Offset field for y positions
     std::shared_ptr<TField> pOff_z; //!< Offset field for z positions
 
-
-    //! Calculates the offset fields, which will be used to actually compute the position and velocity offsets by the Zeldovich evaluator
-    virtual void calculateOffsetFields() {
-      const T nyquist = tools::numerics::fourier::getNyquistModeThatMustBeReal(grid) * grid.getFourierKmin();
+    std::shared_ptr<TCompactField> pCompactOff[3]; //!< Single-precision offset fields (lean memory mode only)
+
+    //! Returns the pointer to the offset field in the given direction (0, 1 or 2 for x, y or z)
+    std::shared_ptr<TField> &getOffsetField(int direction) {
+      switch (direction) {
+        case 0:
+          return pOff_x;
+        case 1:
+          return pOff_y;
+        case 2:
+          return pOff_z;
+        default:
+          throw std::runtime_error("Invalid direction for Zeldovich offset");
+      }
+    }
 
 #ifdef ZELDOVICH_GRADIENT_FOURIER_SPACE
-      auto zeldovichOffsetFields = linearOverdensityField.generateNewFourierFields(
-        [nyquist](complex<T> inputVal, T kx, T ky, T kz) -> std::tuple<complex<T>, complex<T>, complex<T>> {
-          complex<T> result_x;
-          T kfft = kx * kx + ky * ky + kz * kz; // k^2
-
-          // Computes i*inputVal/k^2:
-          result_x.real(-inputVal.imag() / (kfft));
-          result_x.imag(inputVal.real() / (kfft));
-          complex<T> result_y(result_x);
-          complex<T> result_z(result_x);
-
-          result_x *= kx; // i*kx*inputVal/k^2
-          result_y *= ky;
-          result_z *= kz;
-
-          // derivative at nyquist frequency is not defined; set it to zero
-          // potential is also undefined at (0,0,0); set that mode to zero too
-          if (kx == nyquist || kfft == 0)
-            result_x = 0;
-          if (ky == nyquist || kfft == 0)
-            result_y = 0;
-          if (kz == nyquist || kfft == 0)
-            result_z = 0;
-
-          return std::make_tuple(result_x, result_y, result_z);
-        });
+    /*! \brief Returns the Fourier coefficient of the offset along one direction, given that of the overdensity
+        \param inputVal - Fourier coefficient of the overdensity
+        \param kDirection - component of the wavevector along the direction of the offset
+        \param kfft - k^2
+        \param nyquist - wavenumber of the Nyquist mode
+    */
+    static complex<T> getOffsetFourierCoefficient(complex<T> inputVal, T kDirection, T kfft, T nyquist) {
+      // derivative at nyquist frequency is not defined; set it to zero
+      // potential is also undefined at (0,0,0); set that mode to zero too
+      if (kDirection == nyquist || kfft == 0)
+        return 0;
+
+      // Computes i*kDirection*inputVal/k^2:
+      complex<T> result;
+      result.real(-inputVal.imag() / (kfft));
+      result.imag(inputVal.real() / (kfft));
+      result *= kDirection;
+      return result;
+    }
 #else
-      // Solve Poisson equation in Fourier space
+    //! Solves the Poisson equation for the overdensity on this grid, returning the potential in real space
+    TField calculatePotential() {
       auto potentialField = TField(linearOverdensityField);
 
       potentialField.toFourier();
 
       potentialField.forEachFourierCell(
-        [nyquist](complex<T> inputval, T kx, T ky, T kz) -> complex<T> {
+        [](complex<T> inputval, T kx, T ky, T kz) -> complex<T> {
           complex<T> result;
           T kfft = kx * kx + ky * ky + kz * kz; // k^2
           if (kfft == 0)
@@ -191,49 +226,49 @@ namespace particle {
           return result;
       });
       potentialField.toReal();
-      auto grid = potentialField.getGrid();
-      std::vector<GridDataType> &potential = potentialField.getDataVector();
-      auto zeldovichOffsetFields = linearOverdensityField.generateNewFourierFields(
-        [](complex<T> inputVal, T kx, T ky, T kz) -> std::tuple<complex<T>, complex<T>, complex<T>> {
-          return std::make_tuple(0, 0, 0);
-        });
-
-      T a = 1. / 12. / grid.cellSize, b = -2. / 3. / grid.cellSize;
-
-      // Differentiation operator
-      auto differentiate = [a, b, &potential](auto & zeldovichOffsetField, int dir) {
-        Coordinate<int> directionVector;
-        Coordinate<int> negDirectionVector;
-
-        zeldovichOffsetField->toReal();
-        directionVector[dir] = 1;
-        negDirectionVector[dir] = -1;
-
-        // Create zeldovich offset field
-        std::vector<GridDataType> &data = zeldovichOffsetField->getDataVector();
-        auto grid2 = zeldovichOffsetField->getGrid();
+      return potentialField;
+    }
 
-        // Iterate over cells and compute finite difference
-        grid2.parallelIterateOverCellsSpatiallyClustered(
-           [&data, grid2, &potential, a, b, directionVector, negDirectionVector](size_t index){
+    /*! \brief Differentiates the real-space potential, writing the results into the offset fields
 
-          size_t ind_p1, ind_m1, ind_p2, ind_m2;
-          ind_m1 = grid2.getIndexFromIndexAndStep(index, negDirectionVector);
-          ind_m2 = grid2.getIndexFromIndexAndStep(ind_m1, negDirectionVector);
-          ind_p1 = grid2.getIndexFromIndexAndStep(index, directionVector);
-          ind_p2 = grid2.getIndexFromIndexAndStep(ind_p1, directionVector);
+        Any of the offset fields may be null, in which case that component is skipped.
+    */
+    void differentiatePotential(const TField &potentialField, std::shared_ptr<TField> pOffsets[3]) {
+      GridDataType *outputs[3];
+      for (int direction = 0; direction < 3; ++direction) {
+        if (pOffsets[direction] == nullptr) {
+          outputs[direction] = nullptr;
+        } else {
+          assert(!pOffsets[direction]->isFourier());
+          outputs[direction] = pOffsets[direction]->getDataVector().data();
+        }
+      }
+
+      tools::numerics::fourthOrderGradient(potentialField.getDataVector().data(), grid.size, grid.cellSize, outputs);
+    }
+#endif
 
-          // 4th order stencil (with periodic boundaries)
-          data[index] =
-               a * (potential[ind_m2] - potential[ind_p2])
-             + b * (potential[ind_m1] - potential[ind_p1]);
+    //! Calculates the offset fields, which will be used to actually compute the position and velocity offsets by the Zeldovich evaluator
+    virtual void calculateOffsetFields() {
+#ifdef ZELDOVICH_GRADIENT_FOURIER_SPACE
+      const T nyquist = tools::numerics::fourier::getNyquistModeThatMustBeReal(grid) * grid.getFourierKmin();
 
+      auto zeldovichOffsetFields = linearOverdensityField.generateNewFourierFields(
+        [nyquist](complex<T> inputVal, T kx, T ky, T kz) -> std::tuple<complex<T>, complex<T>, complex<T>> {
+          T kfft = kx * kx + ky * ky + kz * kz; // k^2
+          return std::make_tuple(getOffsetFourierCoefficient(inputVal, kx, kfft, nyquist),
+                                 getOffsetFourierCoefficient(inputVal, ky, kfft, nyquist),
+                                 getOffsetFourierCoefficient(inputVal, kz, kfft, nyquist));
         });
+#else
+      // Solve Poisson equation in Fourier space, then take the gradient in real space
+      auto potentialField = calculatePotential();
+      std::shared_ptr<TField> pOffsets[3];
+      for (int direction = 0; direction < 3; ++direction)
+        pOffsets[direction] = std::make_shared<TField>(grid, false);
 
-      };
-      differentiate(std::get<0>(zeldovichOffsetFields), 0);
-      differentiate(std::get<1>(zeldovichOffsetFields), 1);
-      differentiate(std::get<2>(zeldovichOffsetFields), 2);
+      differentiatePotential(potentialField, pOffsets);
+      auto zeldovichOffsetFields = std::make_tuple(pOffsets[0], pOffsets[1], pOffsets[2]);
 
 #endif
       std::tie(this->pOff_x, this->pOff_y, this->pOff_z) = zeldovichOffsetFields;
@@ -246,16 +281,107 @@ namespace particle {
   public:
 
 
-    //! Constructor from a given overdensity field
-    ZeldovichParticleGenerator(TField &linearOverdensityField) :
+    /*! \brief Constructor from a given overdensity field
+        \param linearOverdensityField - overdensity on the grid of this generator
+        \param leanMemory - if true, calculate nothing yet; the caller must calculate and compact the offsets a
+                            component at a time (see calculateOffsetField and compactOffsetField)
+    */
+    ZeldovichParticleGenerator(TField &linearOverdensityField, bool leanMemory = false) :
       ParticleGenerator<GridDataType>(linearOverdensityField.getGrid()),
-      linearOverdensityField(linearOverdensityField) {
-      recalculate();
+      linearOverdensityField(linearOverdensityField), leanMemory(leanMemory) {
+      if (!leanMemory)
+        recalculate();
     }
 
     //! Computes the offset fields using the Zeldovich approximation
     void recalculate() override {
-      calculateOffsetFields();
+      if (leanMemory) {
+        for (int direction = 0; direction < 3; ++direction) {
+          calculateOffsetField(direction);
+          compactOffsetField(direction);
+        }
+      } else {
+        calculateOffsetFields();
+      }
+    }
+
+    //! Computes the offset field in a single direction (0, 1 or 2 for x, y or z) from the overdensity, in real space
+    void calculateOffsetField(int direction) {
+      auto &pOffset = getOffsetField(direction);
+#ifdef ZELDOVICH_GRADIENT_FOURIER_SPACE
+      const T nyquist = tools::numerics::fourier::getNyquistModeThatMustBeReal(grid) * grid.getFourierKmin();
+
+      linearOverdensityField.toFourier();
+      pOffset = std::make_shared<TField>(linearOverdensityField);
+      pOffset->forEachFourierCell([nyquist, direction](complex<T> inputVal, T kx, T ky, T kz) -> complex<T> {
+        T kfft = kx * kx + ky * ky + kz * kz; // k^2
+        T kDirection = direction == 0 ? kx : (direction == 1 ? ky : kz);
+        return getOffsetFourierCoefficient(inputVal, kDirection, kfft, nyquist);
+      });
+#else
+      // Only one component is held at a time, so the potential is recalculated for each
+      auto potentialField = calculatePotential();
+      std::shared_ptr<TField> pOffsets[3];
+      pOffsets[direction] = std::make_shared<TField>(grid, false);
+      differentiatePotential(potentialField, pOffsets);
+      pOffset = pOffsets[direction];
+#endif
+      pOffset->toReal();
+    }
+
+    /*! \brief High-pass filter the offset field in one direction and add the low-pass filtered offset from a generator on another grid, leaving the source compacted.
+
+        Used in lean memory mode. The source's double-precision offset is first compacted, then used as the scratch
+        space for the recombination (see Field::combineWithFieldFromDifferentGrid) and released, so that when filtering
+        on the coarse grid no further temporary is needed.
+    */
+    void combineOffsetFieldAndCompactSource(int direction, ZeldovichParticleGenerator &source,
+                                            const filters::Filter<T> &highPassFilter,
+                                            const filters::Filter<T> &lowPassFilter) {
+      source.storeCompactOffsetField(direction);
+      std::shared_ptr<TField> pSource = std::move(source.getOffsetField(direction));
+      std::shared_ptr<TField> pScratch = pSource;
+      getOffsetField(direction)->combineWithFieldFromDifferentGrid(*pSource, highPassFilter, lowPassFilter, pScratch);
+    }
+
+    //! Stores a single-precision copy of the offset field in one direction
+    void storeCompactOffsetField(int direction) {
+      auto &pOffset = getOffsetField(direction);
+      pOffset->toReal();
+      const auto &data = pOffset->getDataVector();
+
+      pCompactOff[direction] = std::make_shared<TCompactField>(grid, false);
+      auto &compactData = pCompactOff[direction]->getDataVector();
+      size_t size = compactData.size(); // in real space, any padding for the Fourier transform comes at the end
+#pragma omp parallel for
+      for (size_t i = 0; i < size; ++i)
+        compactData[i] = float(tools::datatypes::real_part_if_complex(data[i]));
+    }
+
+    //! Flips the sign of the offset fields in place; the offsets are linear in the overdensity, so need not be recalculated
+    void reverse() override {
+      for (int direction = 0; direction < 3; ++direction) {
+        if (getOffsetField(direction) != nullptr)
+          *getOffsetField(direction) *= GridDataType(-1);
+        if (pCompactOff[direction] != nullptr)
+          *pCompactOff[direction] *= -1.0f;
+      }
+    }
+
+    //! Converts the offset field in one direction to single precision, releasing the double-precision copy
+    void compactOffsetField(int direction) {
+      storeCompactOffsetField(direction);
+      getOffsetField(direction) = nullptr;
+    }
+
+    //! Returns true if the offsets are stored in single precision; see getCompactFields
+    bool isLeanMemory() const {
+      return leanMemory;
+    }
+
+    //! Returns the single-precision offset fields (lean memory mode only)
+    std::vector<std::shared_ptr<TCompactField>> getCompactFields() const {
+      return {pCompactOff[0], pCompactOff[1], pCompactOff[2]};
     }
 
     //! Adds offset fields from another generateo defined on a different grid to the ones generated by this generator
@@ -272,6 +398,20 @@ namespace particle {
       pOff_z->addFieldFromDifferentGridWithFilter(*source.pOff_z, filter);
     }
 
+    /*! \brief High-pass filter the offset fields and add the low-pass filtered offsets from a generator on another grid.
+
+        The scratch field is reused for each of the three offset fields in turn so that only one temporary is needed;
+        see Field::combineWithFieldFromDifferentGrid.
+    */
+    void combineWithFieldsFromDifferentGrid(ZeldovichParticleGenerator &source,
+                                            const filters::Filter<T> &highPassFilter,
+                                            const filters::Filter<T> &lowPassFilter,
+                                            std::shared_ptr<fields::Field<GridDataType, T>> &pScratch) {
+      pOff_x->combineWithFieldFromDifferentGrid(*source.pOff_x, highPassFilter, lowPassFilter, pScratch);
+      pOff_y->combineWithFieldFromDifferentGrid(*source.pOff_y, highPassFilter, lowPassFilter, pScratch);
+      pOff_z->combineWithFieldFromDifferentGrid(*source.pOff_z, highPassFilter, lowPassFilter, pScratch);
+    }
+
     //! Applies a filter to the offset fields
     void applyFilter(const filters::Filter<T> &filter) {
       pOff_x->applyFilter(filter);
@@ -286,9 +426,26 @@ namespace particle {
       pOff_z->toReal();
     }
 
-    //! Returns a tuple with the created offset fields
+    /*! \brief Returns a tuple with the created offset fields
+
+        In lean memory mode, these are new double-precision copies of the compact fields.
+    */
     std::vector<std::shared_ptr<fields::Field<GridDataType>>> getGeneratedFields() override {
-      return {pOff_x, pOff_y, pOff_z};
+      if (!leanMemory)
+        return {pOff_x, pOff_y, pOff_z};
+
+      std::vector<std::shared_ptr<fields::Field<GridDataType>>> copies;
+      for (int direction = 0; direction < 3; ++direction) {
+        const auto &compactData = pCompactOff[direction]->getDataVector();
+        auto pCopy = std::make_shared<TField>(grid, false);
+        auto &data = pCopy->getDataVector();
+        size_t size = compactData.size();
+#pragma omp parallel for
+        for (size_t i = 0; i < size; ++i)
+          data[i] = compactData[i];
+        copies.push_back(pCopy);
+      }
+      return copies;
     }
 
 
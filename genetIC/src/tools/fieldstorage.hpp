@@ -0,0 +1,376 @@
+//
+// Pluggable backing storage for field data: ordinary heap memory, or file-backed memory maps on local disk.
+//
+
+#ifndef IC_FIELDSTORAGE_HPP
+#define IC_FIELDSTORAGE_HPP
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "src/tools/profiling.hpp"
+
+namespace tools {
+  /*! \namespace tools::storage
+      \brief Decides where the data of large fields is stored.
+
+      By default, all field data lives on the heap. If a backing directory has been set (see setBackingDirectory),
+      allocations made while a UseBackingStore object is in scope are instead mem-mapped from unlinked files in that
+      directory. The kernel can then write rarely touched pages of those fields back to disk under memory pressure,
+      rather than swapping or failing, while frequently used fields stay in RAM.
+
+      Large heap blocks are not returned to the system when freed, but kept in a pool keyed by size and handed out
+      again to the next allocation of the same size (see allocateFromHeap). Numerical loops that create and destroy temporary fields of the
+      same grid on every iteration (conjugate gradient, splicing, modifications) then reuse memory that is already
+      mapped in, instead of paying for fresh zero-filled pages each time.
+  */
+  namespace storage {
+
+    namespace detail {
+      //! Directory in which backing files are created; empty if file-backed storage is disabled
+      inline std::string &backingDirectory() {
+        static std::string directory;
+        return directory;
+      }
+
+      //! Allocations smaller than this are always made on the heap
+      inline size_t &minimumBackedBytes() {
+        static size_t bytes = size_t(1) << 20;
+        return bytes;
+      }
+
+      //! Number of UseBackingStore objects currently in scope on this thread
+      inline int &backingRequestDepth() {
+        static thread_local int depth = 0;
+        return depth;
+      }
+
+      //! Start addresses of all live file-backed allocations
+      inline std::set<void *> &mappedRegions() {
+        static std::set<void *> regions;
+        return regions;
+      }
+
+      inline std::mutex &mappedRegionsMutex() {
+        static std::mutex mutex;
+        return mutex;
+      }
+
+      //! Number of live file-backed allocations, so that heap deallocations can skip the lookup when there are none
+      inline std::atomic<size_t> &numMappedRegions() {
+        static std::atomic<size_t> count(0);
+        return count;
+      }
+
+      /*! \struct BlockPool
+          \brief Heap blocks that have been freed but are kept for reuse, grouped by size in bytes.
+
+          Only blocks of at least minimumPooledBytes() are pooled or counted here.
+      */
+      struct BlockPool {
+        std::mutex mutex;
+        std::map<size_t, std::vector<void *>> blocks;
+        size_t pooledBytes = 0; //!< Total size of the blocks currently held for reuse
+        size_t liveBytes = 0; //!< Total size of the poolable blocks currently in use
+        size_t peakLiveBytes = 0; //!< Largest value liveBytes has reached
+      };
+
+      //! The pool is never destroyed, so that fields outliving static destruction can still be freed safely
+      inline BlockPool &blockPool() {
+        static auto pool = new BlockPool;
+        return *pool;
+      }
+
+      //! Heap allocations smaller than this are never pooled
+      inline size_t &minimumPooledBytes() {
+        static size_t bytes = size_t(1) << 16;
+        return bytes;
+      }
+
+      inline void releasePoolWithoutLocking(BlockPool &pool) {
+        for (auto &sizeAndBlocks : pool.blocks)
+          for (void *p : sizeAndBlocks.second)
+            ::operator delete(p);
+        pool.blocks.clear();
+        pool.pooledBytes = 0;
+      }
+
+      //! Releases every pooled block to the system
+      inline void releasePool() {
+        BlockPool &pool = blockPool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        releasePoolWithoutLocking(pool);
+      }
+
+      //! Heap blocks at least this large are marked as candidates for transparent huge pages
+      inline size_t &minimumHugePageBytes() {
+        static size_t bytes = size_t(1) << 21;
+        return bytes;
+      }
+
+      /*! \brief Ask the kernel to back the whole pages within a new block by transparent huge pages, where enabled.
+       *
+       * Large fields are swept through end to end by every operation, so fewer TLB misses help all of them. This is
+       * only a hint, and does nothing if THP is disabled or set to "never".
+       */
+      inline void adviseHugePages(void *p, size_t bytes) {
+#ifdef MADV_HUGEPAGE
+        if (bytes < minimumHugePageBytes())
+          return;
+        const uintptr_t pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+        uintptr_t start = (reinterpret_cast<uintptr_t>(p) + pageSize - 1) & ~(pageSize - 1);
+        uintptr_t end = (reinterpret_cast<uintptr_t>(p) + bytes) & ~(pageSize - 1);
+        if (end > start)
+          ::madvise(reinterpret_cast<void *>(start), end - start, MADV_HUGEPAGE);
+#endif
+      }
+
+      /*! \brief Allocate a heap block, reusing a pooled block of the same size if there is one.
+       *
+       * If a new block is needed and keeping the pool would take the memory held (in use plus pooled) beyond the
+       * peak ever in use, the pool is released first. Pooling therefore never raises the high-water mark of memory.
+       */
+      inline void *allocateFromHeap(size_t bytes) {
+        if (bytes < minimumPooledBytes())
+          return ::operator new(bytes);
+
+        BlockPool &pool = blockPool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+
+        pool.liveBytes += bytes;
+        auto found = pool.blocks.find(bytes);
+        if (found != pool.blocks.end() && !found->second.empty()) {
+          void *p = found->second.back();
+          found->second.pop_back();
+          pool.pooledBytes -= bytes;
+          return p;
+        }
+
+        if (pool.pooledBytes + pool.liveBytes > pool.peakLiveBytes)
+          releasePoolWithoutLocking(pool);
+        pool.peakLiveBytes = std::max(pool.peakLiveBytes, pool.liveBytes);
+
+        void *p;
+        try {
+          p = ::operator new(bytes);
+        } catch (...) {
+          pool.liveBytes -= bytes;
+          throw;
+        }
+        adviseHugePages(p, bytes);
+        return p;
+      }
+
+      //! Return a heap block to the pool for reuse, or to the system if it is too small to be worth pooling
+      inline void deallocateToHeap(void *p, size_t bytes) {
+        if (bytes < minimumPooledBytes()) {
+          ::operator delete(p);
+          return;
+        }
+
+        BlockPool &pool = blockPool();
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.liveBytes -= bytes;
+        pool.blocks[bytes].push_back(p);
+        pool.pooledBytes += bytes;
+      }
+
+      //! Map a new, zero-filled, unlinked file of the given size from the backing directory
+      inline void *allocateFileBacked(size_t bytes) {
+        std::string pattern = backingDirectory() + "/genetIC-field-XXXXXX";
+        int fd = ::mkstemp(&pattern[0]);
+        if (fd == -1)
+          throw std::runtime_error("Failed to create backing file in " + backingDirectory() + " (reason: " +
+                                   std::string(::strerror(errno)) + ")");
+        ::unlink(pattern.c_str()); // the file now disappears as soon as it is unmapped
+
+        if (::ftruncate(fd, bytes) != 0) {
+          ::close(fd);
+          throw std::runtime_error("Failed to size backing file (reason: " + std::string(::strerror(errno)) + ")");
+        }
+
+        void *addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+          throw std::runtime_error("Failed to mem-map backing file (reason: " + std::string(::strerror(errno)) + ")");
+
+        std::lock_guard<std::mutex> lock(mappedRegionsMutex());
+        mappedRegions().insert(addr);
+        ++numMappedRegions();
+        return addr;
+      }
+
+      //! Returns true if the pointer is the start of a live file-backed allocation
+      inline bool isFileBacked(const void *p) {
+        if (numMappedRegions() == 0)
+          return false;
+        std::lock_guard<std::mutex> lock(mappedRegionsMutex());
+        return mappedRegions().count(const_cast<void *>(p)) > 0;
+      }
+
+      inline void *allocate(size_t bytes) {
+        profiling::recordFieldAllocation(bytes);
+        if (backingRequestDepth() > 0 && !backingDirectory().empty() && bytes >= minimumBackedBytes())
+          return allocateFileBacked(bytes);
+        return allocateFromHeap(bytes);
+      }
+
+      inline void deallocate(void *p, size_t bytes) {
+        profiling::recordFieldDeallocation(bytes);
+        if (isFileBacked(p)) {
+          {
+            std::lock_guard<std::mutex> lock(mappedRegionsMutex());
+            mappedRegions().erase(p);
+            --numMappedRegions();
+          }
+          ::munmap(p, bytes);
+        } else {
+          deallocateToHeap(p, bytes);
+        }
+      }
+    }
+
+    /*! \brief Enable file-backed storage in the specified directory, which should be on fast local disk.
+     *
+     * An empty string disables file-backed storage again (existing file-backed allocations are unaffected).
+     */
+    inline void setBackingDirectory(const std::string &directory) {
+      detail::backingDirectory() = directory;
+    }
+
+    //! Free all heap blocks that are being kept for reuse, e.g. before a phase with very different field sizes
+    inline void releasePooledBlocks() {
+      detail::releasePool();
+    }
+
+    /*! \class UseBackingStore
+        \brief While an object of this class is in scope, large allocations on the current thread are file-backed.
+
+        Intended to wrap the creation of fields that are large but rarely used. Has no effect unless a backing
+        directory has been set.
+    */
+    class UseBackingStore {
+    public:
+      UseBackingStore() {
+        ++detail::backingRequestDepth();
+      }
+
+      ~UseBackingStore() {
+        --detail::backingRequestDepth();
+      }
+
+      UseBackingStore(const UseBackingStore &) = delete;
+
+      UseBackingStore &operator=(const UseBackingStore &) = delete;
+    };
+
+    /*! \class FieldAllocator
+        \brief Standard-library compatible allocator for field data, placing it on the heap or in the backing store.
+
+        All instances compare equal; the storage used for a block is decided when it is allocated and remembered
+        until it is freed, so containers using this allocator can be moved and swapped freely.
+    */
+    template<typename T>
+    class FieldAllocator {
+    public:
+      using value_type = T;
+
+      FieldAllocator() noexcept {}
+
+      template<typename U>
+      FieldAllocator(const FieldAllocator<U> &) noexcept {}
+
+      T *allocate(size_t n) {
+        return static_cast<T *>(detail::allocate(n * sizeof(T)));
+      }
+
+      void deallocate(T *p, size_t n) noexcept {
+        detail::deallocate(p, n * sizeof(T));
+      }
+
+      /*! \brief Default-initialise new elements, rather than value-initialising them.
+       *
+       * For arithmetic types this leaves them uninitialised, so that a new vector is not zero-filled (and so first
+       * touched) by the allocating thread. Callers must fill the storage themselves, ideally with fillInParallel or
+       * copyInParallel, so that on NUMA machines each page is placed with the thread that will work on it.
+       */
+      template<typename U>
+      void construct(U *p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new(static_cast<void *>(p)) U;
+      }
+
+      template<typename U, typename... Args>
+      void construct(U *p, Args &&... args) {
+        ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...);
+      }
+    };
+
+    /*! \brief Assign the given value to every element, in parallel.
+     *
+     * The static schedule matches that of the element-wise loops over field data, so on NUMA machines the pages
+     * touched here for the first time end up local to the threads that will later process them.
+     */
+    template<typename T, typename Allocator>
+    void fillInParallel(std::vector<T, Allocator> &data, const T &value, size_t start = 0) {
+      const size_t n = data.size();
+      T *pData = data.data();
+#pragma omp parallel for schedule(static)
+      for (size_t i = start; i < n; ++i)
+        pData[i] = value;
+    }
+
+    //! Make target an element-by-element copy of source, writing it in parallel for the reasons given in fillInParallel
+    template<typename T, typename AllocatorS, typename AllocatorT>
+    void copyInParallel(const std::vector<T, AllocatorS> &source, std::vector<T, AllocatorT> &target) {
+      target.resize(source.size());
+      const size_t n = source.size();
+      const T *pSource = source.data();
+      T *pTarget = target.data();
+#pragma omp parallel for schedule(static)
+      for (size_t i = 0; i < n; ++i)
+        pTarget[i] = pSource[i];
+    }
+
+    template<typename T, typename U>
+    bool operator==(const FieldAllocator<T> &, const FieldAllocator<U> &) noexcept {
+      return true;
+    }
+
+    template<typename T, typename U>
+    bool operator!=(const FieldAllocator<T> &, const FieldAllocator<U> &) noexcept {
+      return false;
+    }
+
+    /*! \brief Hint that the given block will not be needed for a while, so its pages can be written out to disk.
+     *
+     * Does nothing for heap-allocated blocks.
+     */
+    inline void adviseRarelyUsed(const void *p, size_t bytes) {
+      if (!detail::isFileBacked(p))
+        return;
+#if defined(MADV_PAGEOUT)
+      ::madvise(const_cast<void *>(p), bytes, MADV_PAGEOUT);
+#elif defined(MADV_COLD)
+      ::madvise(const_cast<void *>(p), bytes, MADV_COLD);
+#endif
+    }
+
+  }
+}
+
+#endif //IC_FIELDSTORAGE_HPP
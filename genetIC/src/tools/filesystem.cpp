@@ -3,17 +3,59 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <iostream>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
 
 namespace tools {
   //! Returns the directory of the given file
   std::string getDirectoryName(std::string full) {
     char *fullCopy = new char[full.size() + 1];
     std::copy(full.begin(), full.end(), fullCopy);
+    fullCopy[full.size()] = '\0';
     std::string rVal = dirname(fullCopy);
     delete[] fullCopy;
     return rVal;
   }
 
+  //! Returns the absolute, canonical form of the given path, or the path unchanged if it does not exist
+  std::string getAbsolutePath(std::string path) {
+    char *absolutePath = realpath(path.c_str(), nullptr);
+    if (absolutePath == nullptr)
+      return path;
+    std::string rVal = absolutePath;
+    free(absolutePath);
+    return rVal;
+  }
+
+  //! Splits an absolute path into its components
+  static std::vector<std::string> splitPath(const std::string &path) {
+    std::vector<std::string> components;
+    std::stringstream stream(path);
+    std::string component;
+    while (std::getline(stream, component, '/')) {
+      if (!component.empty())
+        components.push_back(component);
+    }
+    return components;
+  }
+
+  //! Returns the path of the file pathTo relative to the directory fromDirectory; both must be absolute and canonical
+  std::string getRelativePath(std::string pathTo, std::string fromDirectory) {
+    auto to = splitPath(pathTo);
+    auto from = splitPath(fromDirectory);
+
+    size_t common = 0;
+    while (common < to.size() && common < from.size() && to[common] == from[common])
+      ++common;
+
+    std::string rVal;
+    for (size_t i = common; i < from.size(); ++i)
+      rVal += "../";
+    for (size_t i = common; i < to.size(); ++i)
+      rVal += to[i] + (i + 1 < to.size() ? "/" : "");
+    return rVal;
+  }
 
   //! Stores the current directory, and then changes to the new one specified by newFolder
   ChangeCwdWhileInScope::ChangeCwdWhileInScope(std::string newFolder) {
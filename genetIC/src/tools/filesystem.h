@@ -21,6 +21,12 @@ namespace tools {
 
   //! Returns the directory of the given file
   std::string getDirectoryName(std::string full);
+
+  //! Returns the absolute, canonical form of the given path, or the path unchanged if it does not exist
+  std::string getAbsolutePath(std::string path);
+
+  //! Returns the path of the file pathTo relative to the directory fromDirectory; both must be absolute and canonical
+  std::string getRelativePath(std::string pathTo, std::string fromDirectory);
 }
 
 #endif
@@ -6,6 +6,7 @@
 #define IC_MEMMAP_HPP
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <string>
 #include <fcntl.h>
 #include <errno.h>
@@ -161,6 +162,12 @@ namespace tools {
       write(fortranFieldSize);
     }
 
+    //! Pad the file with zeros up to the next multiple of the specified alignment
+    void align(size_t alignment) {
+      while(offset%alignment!=0)
+        write<char>(0);
+    }
+
     //! Get a memory-mapped view of the file at the current write location, with the intention of writing n_elements
     template<typename DataType>
     auto getMemMap(size_t n_elements) {
@@ -181,6 +188,86 @@ namespace tools {
     }
 
   };
+
+  /*!
+   \class MemMapFileReader
+   \brief Reads a file through a read-only mem-map of the whole file, with a sequential read position.
+
+   Small items are copied out with the read method; large arrays can be accessed in place with getPointer, so that
+   the data are paged in directly from the file (or the page cache) as they are used.
+  */
+  class MemMapFileReader {
+  protected:
+    int fd; //!< File descriptor, or -1 if no file is open
+    char *addr; //!< Start of the mem-map of the whole file
+    size_t size_bytes; //!< Size of the file
+    size_t offset; //!< Current read location in the file
+
+  public:
+    //! Open the named file and mem-map all of it
+    MemMapFileReader(std::string filename) : addr(nullptr), offset(0) {
+      fd = ::open(filename.c_str(), O_RDONLY);
+      if(fd==-1)
+        throw std::runtime_error("Failed to open file "+filename+" (reason: "+std::string(::strerror(errno))+")");
+
+      struct stat st;
+      if(::fstat(fd, &st)!=0 || st.st_size==0) {
+        ::close(fd);
+        throw std::runtime_error("File "+filename+" is empty or cannot be read");
+      }
+      size_bytes = size_t(st.st_size);
+
+      void *mapped = ::mmap(nullptr, size_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(mapped==MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Failed to create a mem-map for input (reason: "+std::string(::strerror(errno))+")");
+      }
+      addr = static_cast<char*>(mapped);
+      ::madvise(addr, size_bytes, MADV_SEQUENTIAL);
+    }
+
+    //! Disallow copying, since the mem-map would be released twice
+    MemMapFileReader(const MemMapFileReader & copy) = delete;
+
+    //! Destructor. Releases the mem-map and closes the file.
+    ~MemMapFileReader() {
+      if(addr!=nullptr)
+        ::munmap(addr, size_bytes);
+      if(fd!=-1)
+        ::close(fd);
+    }
+
+    //! Read a single item from the current read location
+    template<typename DataType>
+    DataType read() {
+      DataType data;
+      ::memcpy(&data, getPointer<char>(sizeof(DataType)), sizeof(DataType));
+      return data;
+    }
+
+    //! Return a pointer to n_elements items at the current read location, and advance past them
+    template<typename DataType>
+    const DataType* getPointer(size_t n_elements) {
+      size_t n_bytes = n_elements*sizeof(DataType);
+      if(n_bytes > size_bytes-offset)
+        throw std::runtime_error("Unexpected end of file while reading mem-mapped input");
+      const DataType *data = reinterpret_cast<const DataType*>(addr+offset);
+      offset+=n_bytes;
+      return data;
+    }
+
+    //! Advance the read location to the next multiple of the specified alignment
+    void align(size_t alignment) {
+      offset = ((offset+alignment-1)/alignment)*alignment;
+      if(offset > size_bytes)
+        throw std::runtime_error("Unexpected end of file while reading mem-mapped input");
+    }
+
+    //! Returns the number of bytes between the current read location and the end of the file
+    size_t getRemainingBytes() const {
+      return size_bytes-offset;
+    }
+  };
 }
 
 
@@ -5,6 +5,7 @@
 #include <src/simulation/field/field.hpp>
 #include <src/tools/data_types/complex.hpp>
 #include <src/tools/logging.hpp>
+#include <src/tools/profiling.hpp>
 
 namespace tools {
   namespace numerics {
@@ -15,6 +16,7 @@ namespace tools {
                                        const fields::Field<T> &b,
                                        double rtol = 1e-6,
                                        double atol = 1e-12) {
+      profiling::ScopedTimer timer("conjugate_gradient");
       fields::Field<T> residual(b);
       fields::Field<T> direction = -residual;
       fields::Field<T> x = fields::Field<T>(b.getGrid(), false);
@@ -53,6 +55,7 @@ namespace tools {
 
       }
       logging::entry() << "Conjugate gradient ended after " << i << " iterations" << std::endl;
+      profiling::count("iterations", i);
 
       return x;
 
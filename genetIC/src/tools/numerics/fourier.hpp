@@ -3,6 +3,8 @@
 
 
 #include <stdexcept>
+#include <map>
+#include <tuple>
 #include <fftw3.h>
 
 #ifdef _OPENMP
@@ -72,6 +74,73 @@ namespace tools {
         fftwThreadsInitialised = true;
       }
 
+      //! The kinds of transform for which FFTW plans are made
+      enum class PlanType {
+        realToFourier, fourierToReal, complexForward, complexBackward
+      };
+
+      namespace detail {
+        //! Plans made so far, keyed by type, grid size and the address of the (in-place) array they transform
+        inline std::map<std::tuple<PlanType, int, void *>, fftw_plan> &planCache() {
+          static auto cache = new std::map<std::tuple<PlanType, int, void *>, fftw_plan>;
+          return *cache;
+        }
+
+        //! Cached plans are all destroyed when this many have accumulated, to bound the memory they use
+        constexpr size_t maxCachedPlans = 256;
+
+        inline void destroyCachedPlans() {
+          for (auto &plan : planCache())
+            fftw_destroy_plan(plan.second);
+          planCache().clear();
+        }
+      }
+
+      /*! \brief Returns an FFTW plan for an in-place transform of a res^3 grid whose data starts at the given address.
+       *
+       * FFTW plans are tied to the memory they operate on. Field storage is recycled through a pool (see
+       * tools::storage), so temporary fields created in tight loops usually occupy an address that has been planned
+       * for already; plans are therefore cached by address rather than owned by individual fields. A plan remains
+       * valid for any suitably sized array at that address, even once the field that first used it has gone.
+       *
+       * Transforms must be requested and executed by one caller at a time (the FFTW planner is not thread-safe in any
+       * case, and each transform is itself parallelised). Reaching the cache limit destroys every cached plan, which
+       * is only safe because no other transform can be running at that point.
+       */
+      inline fftw_plan getPlan(PlanType type, int res, void *data) {
+        auto key = std::make_tuple(type, res, data);
+        auto found = detail::planCache().find(key);
+        if (found != detail::planCache().end())
+          return found->second;
+
+        if (detail::planCache().size() >= detail::maxCachedPlans)
+          detail::destroyCachedPlans();
+
+        fftw_plan plan;
+        auto complexData = reinterpret_cast<fftw_complex *>(data);
+        switch (type) {
+          case PlanType::realToFourier:
+            plan = fftw_plan_dft_r2c_3d(res, res, res, static_cast<double *>(data), complexData, FFTW_ESTIMATE);
+            break;
+          case PlanType::fourierToReal:
+            plan = fftw_plan_dft_c2r_3d(res, res, res, complexData, static_cast<double *>(data), FFTW_ESTIMATE);
+            break;
+          case PlanType::complexForward:
+            plan = fftw_plan_dft_3d(res, res, res, complexData, complexData, FFTW_FORWARD, FFTW_ESTIMATE);
+            break;
+          default:
+            plan = fftw_plan_dft_3d(res, res, res, complexData, complexData, FFTW_BACKWARD, FFTW_ESTIMATE);
+            break;
+        }
+        detail::planCache()[key] = plan;
+        return plan;
+      }
+
+      //! Destroy all cached plans, e.g. because the number of FFTW threads has changed
+      inline void clearPlanCache() {
+        detail::destroyCachedPlans();
+      }
+
       /*! \class FieldFourierManagerBase
           \brief Class that handles all operations to do with Fourier transforms used by the code.
       */
@@ -284,8 +353,6 @@ namespace tools {
         using T=double;
         int size; //!< Number of elements in the set to apply discrete Fourier transform to.
         size_t compressed_size; //!< Compressed size, exploiting symmetry of real discrete Fourier transforms.
-        fftw_plan forwardPlan; //!< Method used for going from real space to Fourier space.
-        fftw_plan reversePlan; //!< Method used for going from Fourier space to real space.
 
         //! Re-organises the wave-numbers to lie in the positive quadrant, and returns to a linear index (and whether we conjugated the field)
         auto getRealCoeffLocationAndConjugation(int kx, int ky, int kz) const {
@@ -400,20 +467,6 @@ namespace tools {
         FieldFourierManager(fields::Field<double, double> &field) : FieldFourierManagerBase(field) {
           size = static_cast<int>(FieldFourierManagerBase::grid.size);
           compressed_size = FieldFourierManagerBase::grid.size / 2 + 1;
-          forwardPlan = nullptr;
-          reversePlan = nullptr;
-        }
-
-        //! Destructor
-        virtual ~FieldFourierManager() {
-          if (forwardPlan != nullptr) {
-            fftw_destroy_plan(forwardPlan);
-            forwardPlan = nullptr;
-          }
-          if (reversePlan != nullptr) {
-            fftw_destroy_plan(reversePlan);
-            reversePlan = nullptr;
-          }
         }
 
         //! Sets the specified Fourier coefficient to val (accounting for mirrored Fourier modes as real field)
@@ -470,22 +523,13 @@ namespace tools {
           double norm = pow(static_cast<double>(res), 1.5);
 
 
+          // Plans are looked up afresh each time, since the data may have moved (e.g. by move-assigning the field)
           if (transformToFourier) {
             padForFFTWRealTransform();
-            if (forwardPlan == nullptr)
-              forwardPlan = fftw_plan_dft_r2c_3d(res, res, res,
-                                                 &fieldData[0],
-                                                 reinterpret_cast<fftw_complex *>(&fieldData[0]),
-                                                 FFTW_ESTIMATE);
-            plan = forwardPlan;
+            plan = getPlan(PlanType::realToFourier, res, &fieldData[0]);
           } else {
             ensureFourierModesAreMirrored();
-            if (reversePlan == nullptr)
-              reversePlan = fftw_plan_dft_c2r_3d(res, res, res,
-                                                 reinterpret_cast<fftw_complex *>(&fieldData[0]),
-                                                 &fieldData[0],
-                                                 FFTW_ESTIMATE);
-            plan = reversePlan;
+            plan = getPlan(PlanType::fourierToReal, res, &fieldData[0]);
           }
 
 
@@ -551,20 +595,11 @@ namespace tools {
           double norm = pow(static_cast<double>(res), 1.5);
 
           if (!field.isFourier())
-            plan = fftw_plan_dft_3d(res, res, res,
-                                    reinterpret_cast<fftw_complex *>(&fieldData[0]),
-                                    reinterpret_cast<fftw_complex *>(&fieldData[0]),
-                                    FFTW_FORWARD, FFTW_ESTIMATE);
-
+            plan = getPlan(PlanType::complexForward, res, &fieldData[0]);
           else
-            plan = fftw_plan_dft_3d(res, res, res,
-                                    reinterpret_cast<fftw_complex *>(&fieldData[0]),
-                                    reinterpret_cast<fftw_complex *>(&fieldData[0]),
-                                    FFTW_BACKWARD, FFTW_ESTIMATE);
-
+            plan = getPlan(PlanType::complexBackward, res, &fieldData[0]);
 
           fftw_execute(plan);
-          fftw_destroy_plan(plan);
 
           using tools::numerics::operator/=;
           fieldData /= norm;
@@ -607,6 +642,37 @@ namespace tools {
 
       };
 
+      //! A dummy specialisation for single-precision fields, which are only used to store real-space results compactly
+      template<>
+      class FieldFourierManager<float> : public FieldFourierManagerBase<float, double> {
+      public:
+
+        void ensureFourierModesAreMirrored() override {
+
+        }
+
+        FieldFourierManager(fields::Field<float, double> &field) : FieldFourierManagerBase(field) {
+
+        }
+
+        size_t getRequiredDataSize() {
+          return field.getGrid().size3;
+        }
+
+        void performTransform() {
+          throw std::runtime_error("Single-precision fields cannot be Fourier transformed");
+        }
+
+        void setFourierCoefficient(int kx, int ky, int kz, const ComplexType &val) override {
+          throw std::runtime_error("Single-precision fields cannot be Fourier transformed");
+        }
+
+        ComplexType getFourierCoefficient(int kx, int ky, int kz) const override {
+          throw std::runtime_error("Single-precision fields cannot be Fourier transformed");
+        }
+
+      };
+
       //! Returns half the number of elements in the grid if even, and an arbitrary large number otherwise.
       template<typename T>
       int getNyquistModeThatMustBeReal(const grids::Grid<T> &g) {
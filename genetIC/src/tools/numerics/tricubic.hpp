@@ -549,5 +549,19 @@ namespace numerics {
     }
 
   };
+
+  /* \brief Get the 1D weights from which LocalUnitTricubicApproximation is built
+   *
+   * The tricubic approximation is a tensor product of 1D cubics (Catmull-Rom splines), i.e. its value at (x,y,z)
+   * is \sum_ijk w_i(x) w_j(y) w_k(z) cellValues[i][j][k]. The weights w_i(x) for x in [0,1] are returned here, which
+   * allows interpolation onto regular grids to be performed as three successive 1D passes.
+   */
+  template<typename T>
+  void getCubicWeightsForPosition(T x, T weights[4]) {
+    weights[0] = (-x + 2 * fastpow(x, 2) - fastpow(x, 3)) / 2.;
+    weights[1] = (2 - 5 * fastpow(x, 2) + 3 * fastpow(x, 3)) / 2.;
+    weights[2] = (x + 4 * fastpow(x, 2) - 3 * fastpow(x, 3)) / 2.;
+    weights[3] = (-fastpow(x, 2) + fastpow(x, 3)) / 2.;
+  }
 }
 #endif //IC_TRICUBIC_HPP
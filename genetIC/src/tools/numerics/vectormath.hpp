@@ -9,8 +9,8 @@
 namespace tools {
   namespace numerics {
     //! Multiplies vector a by constant b
-    template<typename T, typename S>
-    void operator*=(std::vector<T> &a, S b) {
+    template<typename T, typename A, typename S>
+    void operator*=(std::vector<T, A> &a, S b) {
 #pragma omp parallel for
       for (size_t i = 0; i < a.size(); ++i) {
         a[i] *= b;
@@ -18,8 +18,8 @@ namespace tools {
     }
 
     //! Divides vector a by constant b
-    template<typename T, typename S>
-    void operator/=(std::vector<T> &a, S b) {
+    template<typename T, typename A, typename S>
+    void operator/=(std::vector<T, A> &a, S b) {
 #pragma omp parallel for
       for (size_t i = 0; i < a.size(); ++i) {
         a[i] /= b;
@@ -27,8 +27,8 @@ namespace tools {
     }
 
     //! Multiplies each element of vector a by the corresponding element of vector b
-    template<typename T>
-    void operator*=(std::vector<T> &a, const std::vector<T> &b) {
+    template<typename T, typename A, typename B>
+    void operator*=(std::vector<T, A> &a, const std::vector<T, B> &b) {
       assert(a.size() == b.size());
 #pragma omp parallel for
       for (size_t i = 0; i < a.size(); ++i) {
@@ -37,8 +37,8 @@ namespace tools {
     }
 
     //! Adds b to a, element-wise
-    template<typename T>
-    void operator+=(std::vector<T> &a, const std::vector<T> &b) {
+    template<typename T, typename A, typename B>
+    void operator+=(std::vector<T, A> &a, const std::vector<T, B> &b) {
       assert(a.size() == b.size());
 #pragma omp parallel for
       for (size_t i = 0; i < a.size(); ++i) {
@@ -47,8 +47,8 @@ namespace tools {
     }
 
     //! Divides each element of vector a by the corresponding element of vector b
-    template<typename T>
-    void operator/=(std::vector<T> &a, const std::vector<T> &b) {
+    template<typename T, typename A, typename B>
+    void operator/=(std::vector<T, A> &a, const std::vector<T, B> &b) {
       assert(a.size() == b.size());
 #pragma omp parallel for
       for (size_t i = 0; i < a.size(); ++i) {
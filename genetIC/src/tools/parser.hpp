@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "logging.hpp"
+#include "profiling.hpp"
 
 namespace tools {
   /*! \class DispatchError
@@ -37,6 +38,56 @@ namespace tools {
 
   };
 
+  /*! \class ArgumentList
+      \brief A list of values taking up the rest of a command, e.g. "random_seeds 100 101 102".
+
+      A function taking an ArgumentList must take it as its last argument. At least one value is required.
+  */
+  template<typename T>
+  class ArgumentList : public std::vector<T> {
+  };
+
+  //! Read values into an ArgumentList until the end of the command, or a comment, is reached
+  template<typename T>
+  std::istream &operator>>(std::istream &input_stream, ArgumentList<T> &list) {
+    list.clear();
+    std::string token;
+    while (input_stream >> token) {
+      if (token[0] == '#' || token[0] == '%') {
+        // put the comment back, so that it is consumed in the usual way
+        input_stream.clear();
+        input_stream.seekg(-std::streamoff(token.size()), std::ios::cur);
+        return input_stream;
+      }
+      std::istringstream token_stream(token);
+      T value{};
+      token_stream >> value;
+      if (token_stream.fail()) {
+        input_stream.setstate(std::ios::failbit);
+        return input_stream;
+      }
+      list.push_back(value);
+    }
+
+    // running out of input is the expected way to finish the list, so only an empty list is an error
+    if (list.empty())
+      input_stream.setstate(std::ios::failbit);
+    else
+      input_stream.clear(std::ios::eofbit);
+    return input_stream;
+  }
+
+  //! Write the values in an ArgumentList separated by spaces, as they would appear in a parameter file
+  template<typename T>
+  std::ostream &operator<<(std::ostream &output_stream, const ArgumentList<T> &list) {
+    for (size_t i = 0; i < list.size(); ++i) {
+      if (i > 0)
+        output_stream << " ";
+      output_stream << list[i];
+    }
+    return output_stream;
+  }
+
   //! Skips over any comments, and throws errors if we end up with too many arguments in an string.
   void consume_comments(std::istream &input_stream) {
     std::string s;
@@ -363,8 +414,11 @@ namespace tools {
     //! Wraps the member function inside a std::function that can be added to the (string,function) map.
     template<typename... Args>
     void add_class_route(const std::string &name, Rtype (Ctype::*f)(Args...)) {
-      // make a lambda that performs the call
-      auto call = [this, f](Args... input_args) { (pC->*f)(input_args...); };
+      // make a lambda that performs the call, timing it for the profiling report
+      auto call = [this, f, name](Args... input_args) {
+        profiling::ScopedTimer timer(name);
+        (pC->*f)(input_args...);
+      };
       // add it as the route
       this->add_route(name, std::function<Rtype(Args...)>(call));
     }
@@ -375,6 +429,7 @@ namespace tools {
       auto call = [this, f, name, preferredName](Args... input_args) {
         logging::entry(logging::level::warning) << "WARNING: " << name << " is a deprecated command and has been replaced by " << preferredName
                   << std::endl;
+        profiling::ScopedTimer timer(name);
         (pC->*f)(input_args...);
       };
 
@@ -0,0 +1,219 @@
+//
+// Lightweight hierarchical timing and memory profiling, reported at the end of a run.
+//
+
+#ifndef IC_PROFILING_HPP
+#define IC_PROFILING_HPP
+
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace tools {
+  /*! \namespace tools::profiling
+      \brief Records how long each parameter-file command, and the expensive stages within it, take.
+
+      Code regions are timed by placing a ScopedTimer in them. Timers nest, giving a tree of named regions; repeated
+      entries into the same region from the same parent are accumulated. Each region also records the peak memory
+      held in fields while it was active, and the peak resident set size of the process when it finished.
+
+      Timers only record when constructed outside OpenMP parallel regions, so the overhead is one clock read and a
+      short search among siblings per timed region, and they can be left on in production runs.
+  */
+  namespace profiling {
+
+    /*! \struct Node
+        \brief Accumulated statistics for one named region within its parent.
+    */
+    struct Node {
+      std::string name;
+      Node *parent;
+      std::vector<std::unique_ptr<Node>> children;
+      std::map<std::string, size_t> counters; //!< Event counts recorded within this region, e.g. iterations
+      size_t calls = 0;
+      double seconds = 0.0;
+      size_t peakFieldBytes = 0; //!< Largest total size of all field data allocated while this region was active
+      long maxRssKilobytes = 0; //!< Peak resident set size of the process on leaving this region
+
+      Node(const std::string &name, Node *parent) : name(name), parent(parent) {}
+
+      //! Returns the child with the given name, creating it if necessary
+      Node *getChild(const std::string &childName) {
+        for (auto &child : children)
+          if (child->name == childName)
+            return child.get();
+        children.emplace_back(std::make_unique<Node>(childName, this));
+        return children.back().get();
+      }
+    };
+
+    namespace detail {
+      inline Node &root() {
+        static Node rootNode("total", nullptr);
+        return rootNode;
+      }
+
+      inline Node *&current() {
+        static Node *currentNode = &root();
+        return currentNode;
+      }
+
+      inline std::chrono::steady_clock::time_point startTime() {
+        static auto start = std::chrono::steady_clock::now();
+        return start;
+      }
+
+      inline std::atomic<size_t> &currentFieldBytes() {
+        static std::atomic<size_t> bytes(0);
+        return bytes;
+      }
+
+      inline std::atomic<size_t> &peakFieldBytes() {
+        static std::atomic<size_t> bytes(0);
+        return bytes;
+      }
+
+      inline bool inParallelRegion() {
+#ifdef _OPENMP
+        return omp_in_parallel();
+#else
+        return false;
+#endif
+      }
+
+      inline long getMaxRssKilobytes() {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+          return 0;
+        return usage.ru_maxrss;
+      }
+
+      inline void writeJson(std::ostream &out, const Node &node, int indent) {
+        std::string pad(size_t(indent) * 2, ' ');
+        out << pad << "{\"name\": \"" << node.name << "\", \"calls\": " << node.calls
+            << ", \"seconds\": " << node.seconds << ", \"peak_field_bytes\": " << node.peakFieldBytes
+            << ", \"max_rss_kb\": " << node.maxRssKilobytes;
+        if (!node.counters.empty()) {
+          out << ", \"counters\": {";
+          bool first = true;
+          for (auto &counter : node.counters) {
+            out << (first ? "" : ", ") << "\"" << counter.first << "\": " << counter.second;
+            first = false;
+          }
+          out << "}";
+        }
+        out << ", \"children\": [";
+        if (!node.children.empty()) {
+          out << "\n";
+          for (size_t i = 0; i < node.children.size(); ++i) {
+            writeJson(out, *node.children[i], indent + 1);
+            out << (i + 1 < node.children.size() ? ",\n" : "\n");
+          }
+          out << pad;
+        }
+        out << "]}";
+      }
+
+      inline void writeCsv(std::ostream &out, const Node &node, const std::string &parentPath) {
+        std::string path = parentPath.empty() ? node.name : parentPath + "/" + node.name;
+        out << path << "," << node.calls << "," << node.seconds << "," << node.peakFieldBytes << ","
+            << node.maxRssKilobytes << std::endl;
+        for (auto &child : node.children)
+          writeCsv(out, *child, path);
+      }
+    }
+
+    //! Record the allocation of field data of the given size
+    inline void recordFieldAllocation(size_t bytes) {
+      size_t now = (detail::currentFieldBytes() += bytes);
+      size_t peak = detail::peakFieldBytes();
+      while (now > peak && !detail::peakFieldBytes().compare_exchange_weak(peak, now));
+    }
+
+    //! Record the release of field data of the given size
+    inline void recordFieldDeallocation(size_t bytes) {
+      detail::currentFieldBytes() -= bytes;
+    }
+
+    //! Add to a named event counter in the region currently being timed
+    inline void count(const std::string &counterName, size_t n = 1) {
+      if (detail::inParallelRegion())
+        return;
+      detail::current()->counters[counterName] += n;
+    }
+
+    /*! \class ScopedTimer
+        \brief Times the region of code in which it is in scope, as a child of any enclosing timed region.
+    */
+    class ScopedTimer {
+    protected:
+      Node *node; //!< Region being timed, or nullptr if this timer is inactive
+      std::chrono::steady_clock::time_point start;
+      size_t enclosingPeakFieldBytes;
+
+    public:
+      explicit ScopedTimer(const std::string &name) : node(nullptr) {
+        if (detail::inParallelRegion())
+          return;
+        detail::startTime();
+        node = detail::current()->getChild(name);
+        detail::current() = node;
+
+        // Track the peak within this region separately, then fold it back into the enclosing peak on exit
+        enclosingPeakFieldBytes = detail::peakFieldBytes();
+        detail::peakFieldBytes() = detail::currentFieldBytes().load();
+        start = std::chrono::steady_clock::now();
+      }
+
+      ~ScopedTimer() {
+        if (node == nullptr)
+          return;
+        auto end = std::chrono::steady_clock::now();
+        node->calls += 1;
+        node->seconds += std::chrono::duration<double>(end - start).count();
+
+        size_t peakInRegion = detail::peakFieldBytes();
+        node->peakFieldBytes = std::max(node->peakFieldBytes, peakInRegion);
+        detail::peakFieldBytes() = std::max(enclosingPeakFieldBytes, peakInRegion);
+        node->maxRssKilobytes = detail::getMaxRssKilobytes();
+
+        detail::current() = node->parent;
+      }
+
+      ScopedTimer(const ScopedTimer &) = delete;
+
+      ScopedTimer &operator=(const ScopedTimer &) = delete;
+    };
+
+    /*! \brief Write the profile gathered so far to filenameStem.json (as a tree) and filenameStem.csv (one row per
+     * region, identified by its path from the root).
+     */
+    inline void writeReport(const std::string &filenameStem) {
+      Node &root = detail::root();
+      root.calls = 1;
+      root.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - detail::startTime()).count();
+      root.peakFieldBytes = detail::peakFieldBytes();
+      root.maxRssKilobytes = detail::getMaxRssKilobytes();
+
+      std::ofstream json(filenameStem + ".json");
+      detail::writeJson(json, root, 0);
+      json << std::endl;
+
+      std::ofstream csv(filenameStem + ".csv");
+      csv << "region,calls,seconds,peak_field_bytes,max_rss_kb" << std::endl;
+      detail::writeCsv(csv, root, "");
+    }
+
+  }
+}
+
+#endif //IC_PROFILING_HPP
@@ -4,6 +4,8 @@
 #include <vector>
 #include <cmath>
 #include <stdexcept>
+#include <algorithm>
+#include <omp.h>
 /*!
     \namespace tools
     \brief Defines useful functions and tools used throughout the code
@@ -91,10 +93,36 @@ namespace tools {
     return array;
   }
 
+  //! Sorts a vector in ascending order, splitting large vectors into one sorted run per thread and merging the runs
+  template<typename T>
+  void parallelSort(std::vector<T> &vector) {
+    size_t nRuns = size_t(omp_get_max_threads());
+    if (nRuns < 2 || vector.size() < 65536) {
+      std::sort(vector.begin(), vector.end());
+      return;
+    }
+
+    std::vector<size_t> runStart(nRuns + 1);
+    for (size_t i = 0; i <= nRuns; ++i)
+      runStart[i] = vector.size() * i / nRuns;
+
+#pragma omp parallel for schedule(static, 1)
+    for (size_t i = 0; i < nRuns; ++i)
+      std::sort(vector.begin() + runStart[i], vector.begin() + runStart[i + 1]);
+
+    // Merge neighbouring runs pairwise, halving the number of runs on each pass
+    for (size_t width = 1; width < nRuns; width *= 2) {
+#pragma omp parallel for schedule(dynamic, 1)
+      for (size_t i = 0; i < nRuns - width; i += 2 * width)
+        std::inplace_merge(vector.begin() + runStart[i], vector.begin() + runStart[i + width],
+                           vector.begin() + runStart[std::min(i + 2 * width, nRuns)]);
+    }
+  }
+
   //! Sorts a vector and removes any duplicated entries (used for sorting lists of flagged cells)
   template<typename T>
   void sortAndEraseDuplicate( std::vector<T> & vector){
-    std::sort(vector.begin(), vector.end());
+    parallelSort(vector);
     vector.erase(std::unique(vector.begin(), vector.end()), vector.end());
   }
 
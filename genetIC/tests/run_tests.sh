@@ -1,13 +1,31 @@
 #!/usr/bin/env bash
 
+# Runs the test in directory $1 and compares its output with the reference. Tests that use a cache directory start
+# from an empty cache, and are then run again (with $2 set to "warm") to check that loading everything from the cache
+# gives the same output; the cache is deleted afterwards.
 function runtest {
   command -v python >/dev/null && PYTHON=python || PYTHON=python3
   rm $1/*.tipsy 2>/dev/null
+  if [[ "$2" != "warm" ]]
+  then
+      rm -rf $1/cache
+  fi
   echo -n "Running test on $1   "
   head -1  $1/paramfile.txt
   cd $1 || exit
-  IC=${IC:-../../genetIC}
-  command="$IC paramfile.txt > IC_output.txt 2>&1"
+  local executable=${IC:-../../genetIC}
+  if [[ "$1" == *fd_gradient* ]]
+  then
+      executable=${IC_FD_GRADIENT:-../../genetIC_fd_gradient}
+      if ! command -v $executable >/dev/null
+      then
+          echo "--> SKIPPED: $executable not found; type 'make fd_gradient' in the genetIC folder to run this test"
+          echo
+          cd ..
+          return
+      fi
+  fi
+  command="$executable paramfile.txt > IC_output.txt 2>&1"
   eval "$command"
   if [[ $? -ne 0 && "$1" != *error* ]]
   then
@@ -30,6 +48,20 @@ function runtest {
   else
       echo
   fi
+
+  if [[ "$2" == "warm" ]]
+  then
+      if ! grep -q "from cache" $1/IC_output.txt
+      then
+          echo "--> TEST FAILED: nothing was loaded from the cache"
+          exit 1
+      fi
+      rm -rf $1/cache
+  elif grep -q "^cache_directory" $1/paramfile.txt
+  then
+      echo -n "(with warm cache) "
+      runtest $1 warm
+  fi
 }
 
 